@@ -0,0 +1,192 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/*
+ * Prints the records of a trace file written by the OpenOCD "io_trace"
+ * command, oldest first. RISC-V DMI accesses to the main Debug Module
+ * registers are decoded field by field.
+ *
+ * Build it together with src/target/riscv/debug_reg_printer.c and
+ * src/target/riscv/debug_defines.c, with src/helper and src/target/riscv
+ * in the include path.
+ *
+ * The trace must be decoded on a host with the same byte order as the one
+ * that wrote it.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "io_trace.h"
+#include "debug_defines.h"
+#include "debug_reg_printer.h"
+
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
+
+/* Same registers as log_batch() in src/target/riscv/batch.c decodes */
+static const struct {
+	uint32_t address;
+	enum riscv_debug_reg_ordinal ordinal;
+} dm_registers[] = {
+	{DM_DMCONTROL, DM_DMCONTROL_ORDINAL},
+	{DM_DMSTATUS, DM_DMSTATUS_ORDINAL},
+	{DM_ABSTRACTCS, DM_ABSTRACTCS_ORDINAL},
+	{DM_COMMAND, DM_COMMAND_ORDINAL},
+	{DM_SBCS, DM_SBCS_ORDINAL}
+};
+
+/* The previous DMI scan; the result of a read comes with the next scan */
+static struct io_trace_dmi last_dmi;
+static int have_last_dmi;
+
+static void print_dm_register(const char *access, uint32_t dm_base,
+		uint32_t address, uint32_t data)
+{
+	for (unsigned int i = 0; i < ARRAY_SIZE(dm_registers); i++) {
+		if (dm_registers[i].address + dm_base != address)
+			continue;
+
+		const struct riscv_debug_reg_ctx context = {
+			.XLEN = { .value = 0, .is_set = 0 },
+			.DXLEN = { .value = 0, .is_set = 0 },
+			.abits = { .value = 0, .is_set = 0 },
+		};
+		unsigned int length = riscv_debug_reg_to_s(NULL, dm_registers[i].ordinal,
+				context, data, RISCV_DEBUG_REG_HIDE_ALL_0);
+		char *text = malloc(length + 1);
+		if (!text)
+			return;
+		riscv_debug_reg_to_s(text, dm_registers[i].ordinal, context, data,
+				RISCV_DEBUG_REG_HIDE_ALL_0);
+		printf("                    %s: %s\n", access, text);
+		free(text);
+		return;
+	}
+}
+
+static void print_dmi(const struct io_trace_dmi *dmi)
+{
+	static const char * const op_string[] = {"-", "r", "w", "?"};
+	static const char * const status_string[] = {"+", "?", "F", "b"};
+	const unsigned int num_bits = dmi->abits + DTM_DMI_DATA_LENGTH + DTM_DMI_OP_LENGTH;
+
+	printf("dmi %" PRId16 ": %ub %s %08" PRIx32 " @%02" PRIx32, dmi->coreid,
+			num_bits, op_string[dmi->op_out & 3], dmi->data_out, dmi->address);
+	if (dmi->op_in == 0xff)
+		printf(" -> ?; %" PRIu32 "i\n", dmi->idle);
+	else
+		printf(" -> %s %08" PRIx32 " @%02" PRIx32 "; %" PRIu32 "i\n",
+				status_string[dmi->op_in & 3], dmi->data_in, dmi->address_in,
+				dmi->idle);
+
+	if (have_last_dmi && last_dmi.coreid == dmi->coreid
+			&& last_dmi.op_out == DTM_DMI_OP_READ
+			&& dmi->op_in == DTM_DMI_OP_SUCCESS)
+		print_dm_register("read", dmi->dm_base, last_dmi.address, dmi->data_in);
+	if (dmi->op_out == DTM_DMI_OP_WRITE)
+		print_dm_register("write", dmi->dm_base, dmi->address, dmi->data_out);
+
+	last_dmi = *dmi;
+	have_last_dmi = 1;
+}
+
+static void print_usb(const char *name, const struct io_trace_usb *usb, int complete)
+{
+	if (complete)
+		printf("%s: write %" PRIu32 "/%" PRIu32 ", read %" PRIu32 "/%" PRIu32
+				", status %" PRId32 "\n", name,
+				usb->write_transferred, usb->write_count,
+				usb->read_transferred, usb->read_count, usb->status);
+	else
+		printf("%s: write %" PRIu32 ", read %" PRIu32 "\n", name,
+				usb->write_count, usb->read_count);
+}
+
+static void print_record(const struct io_trace_record *record)
+{
+	printf("%" PRIu32 " %" PRIu64 ".%06" PRIu64 " ", record->sequence,
+			record->time_us / 1000000, record->time_us % 1000000);
+
+	union {
+		struct io_trace_dmi dmi;
+		struct io_trace_usb usb;
+		uint8_t bytes[IO_TRACE_PAYLOAD_SIZE];
+	} payload;
+	memset(&payload, 0, sizeof(payload));
+	memcpy(&payload, record->payload,
+			record->size < sizeof(payload) ? record->size : sizeof(payload));
+
+	switch (record->type) {
+	case IO_TRACE_RISCV_DMI:
+		print_dmi(&payload.dmi);
+		break;
+	case IO_TRACE_MPSSE_SUBMIT:
+		print_usb("mpsse submit", &payload.usb, 0);
+		break;
+	case IO_TRACE_MPSSE_COMPLETE:
+		print_usb("mpsse complete", &payload.usb, 1);
+		break;
+	default:
+		printf("type %" PRIu16 ":", record->type);
+		for (unsigned int i = 0; i < record->size && i < sizeof(payload); i++)
+			printf(" %02x", payload.bytes[i]);
+		printf("\n");
+		break;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s trace_file\n", argv[0]);
+		return 1;
+	}
+
+	FILE *file = fopen(argv[1], "rb");
+	if (!file) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	struct io_trace_header header;
+	if (fread(&header, sizeof(header), 1, file) != 1
+			|| memcmp(header.magic, IO_TRACE_MAGIC, sizeof(header.magic))) {
+		fprintf(stderr, "%s: not an OpenOCD I/O trace\n", argv[1]);
+		fclose(file);
+		return 1;
+	}
+
+	if (header.byte_order != IO_TRACE_BYTE_ORDER
+			|| header.version != IO_TRACE_VERSION
+			|| header.header_size != sizeof(header)
+			|| header.record_size != sizeof(struct io_trace_record)
+			|| !header.capacity) {
+		fprintf(stderr, "%s: unsupported trace version or byte order\n", argv[1]);
+		fclose(file);
+		return 1;
+	}
+
+	/* Once the ring has wrapped, the oldest record is in the next slot */
+	uint64_t count = header.head < header.capacity ? header.head : header.capacity;
+	uint64_t slot = header.head < header.capacity ? 0 : header.head % header.capacity;
+
+	for (uint64_t i = 0; i < count; i++) {
+		struct io_trace_record record;
+		long offset = (long)(sizeof(header) + slot * sizeof(record));
+
+		if (fseek(file, offset, SEEK_SET) != 0
+				|| fread(&record, sizeof(record), 1, file) != 1) {
+			fprintf(stderr, "%s: truncated trace\n", argv[1]);
+			fclose(file);
+			return 1;
+		}
+		print_record(&record);
+
+		if (++slot == header.capacity)
+			slot = 0;
+	}
+
+	fclose(file);
+	return 0;
+}
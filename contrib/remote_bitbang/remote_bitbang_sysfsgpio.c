@@ -390,6 +390,36 @@ static void cleanup_all_fds(void)
 	cleanup_fd(srst_fd, srst_gpio);
 }
 
+/*
+ * Block scan: shift a vector of bits, TMS high on the last bit only if
+ * requested, and send back TDO if requested. Both packed LSB first.
+ */
+static void process_block_scan(void)
+{
+	int flags = getchar();
+	int bit_cnt = getchar();
+	bit_cnt |= getchar() << 8;
+	int tdi = 0;
+	int tdo = 0;
+
+	for (int i = 0; i < bit_cnt; i++) {
+		int tms = (flags & 0x02) && i == bit_cnt - 1;
+
+		if (i % 8 == 0)
+			tdi = getchar();
+
+		sysfsgpio_write(0, tms, (tdi >> (i % 8)) & 1);
+		if (flags & 0x01)
+			tdo |= (sysfsgpio_read() == '1') << (i % 8);
+		sysfsgpio_write(1, tms, (tdi >> (i % 8)) & 1);
+
+		if ((flags & 0x01) && (i % 8 == 7 || i == bit_cnt - 1)) {
+			putchar(tdo);
+			tdo = 0;
+		}
+	}
+}
+
 static void process_remote_protocol(void)
 {
 	int c;
@@ -414,6 +444,10 @@ static void process_remote_protocol(void)
 			putchar(sysfsgpio_swdio_read());
 		else if (c == 'o' || c == 'O') /* SWDIO drive */
 			sysfsgpio_swdio_drive(c == 'o' ? 0 : 1);
+		else if (c == 'V') /* Protocol version */
+			putchar('2');
+		else if (c == 'S') /* Block scan */
+			process_block_scan();
 		else if (c >= 'd' && c <= 'g') { /* SWD write */
 			char d = c - 'd';
 			sysfsgpio_swd_write((d & 2), (d & 1));
@@ -727,8 +727,99 @@ static bool flash_write_check_gap(struct flash_bank *bank,
 }
 
 
+/* One block of image data written to a bank by flash_write_unlock_verify() */
+struct flash_image_run {
+	/* position in the image where the run starts and the one after it */
+	unsigned int section;
+	uint32_t section_offset;
+	unsigned int next_section;
+	uint32_t next_section_offset;
+
+	target_addr_t address;
+	uint32_t size;
+	/* the bank's default_padded_value used to fill the gaps */
+	uint8_t pad_value;
+	uint8_t *buffer;
+
+	bool crc_valid;
+	uint32_t crc;
+};
+
+static struct flash_image_run *flash_image_cache_find(struct flash_image_cache *cache,
+	unsigned int section, uint32_t section_offset, target_addr_t address, uint32_t size,
+	uint8_t pad_value)
+{
+	for (unsigned int i = 0; i < cache->num_runs; i++) {
+		struct flash_image_run *run = &cache->runs[i];
+		if (run->section == section && run->section_offset == section_offset &&
+				run->address == address && run->size == size &&
+				run->pad_value == pad_value)
+			return run;
+	}
+
+	return NULL;
+}
+
+static struct flash_image_run *flash_image_cache_add(struct flash_image_cache *cache)
+{
+	struct flash_image_run *runs = realloc(cache->runs,
+		(cache->num_runs + 1) * sizeof(*runs));
+	if (!runs)
+		return NULL;
+
+	cache->runs = runs;
+	return memset(&runs[cache->num_runs++], 0, sizeof(*runs));
+}
+
+void flash_image_cache_free(struct flash_image_cache *cache)
+{
+	for (unsigned int i = 0; i < cache->num_runs; i++)
+		free(cache->runs[i].buffer);
+	free(cache->runs);
+	cache->runs = NULL;
+	cache->num_runs = 0;
+}
+
+/* Verifies a run against its checksum, which is computed only once for all
+ * the targets. Drivers with their own verify method are left to it. */
+static int flash_verify_run(struct flash_bank *bank, struct flash_image_run *run)
+{
+	uint32_t target_crc;
+	int retval;
+
+	if (bank->driver->verify)
+		return flash_driver_verify(bank, run->buffer, run->address - bank->base, run->size);
+
+	if (!run->crc_valid) {
+		retval = image_calculate_checksum(run->buffer, run->size, &run->crc);
+		if (retval != ERROR_OK)
+			return retval;
+		run->crc_valid = true;
+	}
+
+	retval = target_checksum_memory(bank->target, run->address, run->size, &target_crc);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (target_crc != run->crc) {
+		LOG_ERROR("verify failed in bank at " TARGET_ADDR_FMT " starting at 0x%8.8" PRIx32,
+			bank->base, (uint32_t)(run->address - bank->base));
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
 int flash_write_unlock_verify(struct target *target, struct image *image,
 	uint32_t *written, bool erase, bool unlock, bool write, bool verify)
+{
+	return flash_write_unlock_verify_cached(target, image, NULL, written,
+		erase, unlock, write, verify);
+}
+
+int flash_write_unlock_verify_cached(struct target *target, struct image *image,
+	struct flash_image_cache *cache, uint32_t *written, bool erase,
+	bool unlock, bool write, bool verify)
 {
 	int retval = ERROR_OK;
 
@@ -894,6 +985,19 @@ int flash_write_unlock_verify(struct target *target, struct image *image,
 			run_size += delta;
 		}
 
+		const unsigned int run_section = section;
+		const uint32_t run_section_offset = section_offset;
+		struct flash_image_run *run = NULL;
+		if (cache)
+			run = flash_image_cache_find(cache, section, section_offset,
+				run_address, run_size, c->default_padded_value);
+		if (run) {
+			/* the image data was read for a previous target already */
+			section = run->next_section;
+			section_offset = run->next_section_offset;
+			goto program;
+		}
+
 		/* allocate buffer */
 		buffer = malloc(run_size);
 		if (!buffer) {
@@ -949,6 +1053,28 @@ int flash_write_unlock_verify(struct target *target, struct image *image,
 			}
 		}
 
+		if (cache) {
+			run = flash_image_cache_add(cache);
+			if (!run) {
+				LOG_ERROR("Out of memory");
+				free(buffer);
+				retval = ERROR_FAIL;
+				goto done;
+			}
+			run->section = run_section;
+			run->section_offset = run_section_offset;
+			run->next_section = section;
+			run->next_section_offset = section_offset;
+			run->address = run_address;
+			run->size = run_size;
+			run->pad_value = c->default_padded_value;
+			run->buffer = buffer;
+		}
+
+program:
+		if (run)
+			buffer = run->buffer;
+
 		retval = ERROR_OK;
 
 		if (unlock)
@@ -971,11 +1097,16 @@ int flash_write_unlock_verify(struct target *target, struct image *image,
 		if (retval == ERROR_OK) {
 			if (verify) {
 				/* verify flash sectors */
-				retval = flash_driver_verify(c, buffer, run_address - c->base, run_size);
+				if (run)
+					retval = flash_verify_run(c, run);
+				else
+					retval = flash_driver_verify(c, buffer, run_address - c->base, run_size);
 			}
 		}
 
-		free(buffer);
+		/* the cache keeps the buffer for the next target */
+		if (!run)
+			free(buffer);
 
 		if (retval != ERROR_OK) {
 			/* abort operation */
@@ -123,6 +123,31 @@ static int hydrogen_wait_algo_done(struct flash_bank *bank, int timeout_ms)
 	return ERROR_OK;
 }
 
+/* Waits until the helper has taken @a command off the command word, and
+ * returns what it left there: HYDROGEN_BUFFER_EMPTY on success, or the
+ * helper's own failure status. ERROR_TARGET_TIMEOUT means the helper did
+ * not finish at all. */
+static int hydrogen_wait_algo_status(struct flash_bank *bank, uint32_t command,
+	int timeout_ms, uint32_t *status)
+{
+	struct target *target = bank->target;
+	long long start_ms = timeval_ms();
+
+	for (;;) {
+		int retval = target_read_u32(target, HYDROGEN_RAM_ADDRESS_COMMAND, status);
+		if (retval != ERROR_OK)
+			return retval;
+		if (*status != command)
+			return ERROR_OK;
+
+		long long elapsed_ms = timeval_ms() - start_ms;
+		if (elapsed_ms > 500)
+			keep_alive();
+		if (elapsed_ms > timeout_ms)
+			return ERROR_TARGET_TIMEOUT;
+	}
+}
+
 static int hydrogen_init(struct flash_bank *bank)
 {
 	struct target *target = bank->target;
@@ -753,10 +778,52 @@ static int get_hydrogen_info(struct flash_bank *bank, struct command_invocation
 //	COMMAND_REGISTRATION_DONE
 //};
 
+/* Reads a sector through the helper's page buffer until a byte that is not
+ * erased shows up. The helper algorithm must be running. */
+static int hydrogen_sector_is_erased(struct flash_bank *bank, unsigned int sector,
+	bool *erased)
+{
+	struct target *target = bank->target;
+	uint8_t buffer[HYDROGEN_RAM_SIZE_IMG_BUF];
+	uint32_t offset = bank->sectors[sector].offset;
+	uint32_t count = bank->sectors[sector].size;
+	int retval;
+
+	*erased = true;
+	while (count > 0) {
+		uint32_t size = MIN(count, HYDROGEN_RAM_SIZE_IMG_BUF);
+
+		target_write_u32(target, HYDROGEN_RAM_ADDRESS_CMD_DATA, offset + (uint32_t)bank->base);
+		target_write_u32(target, HYDROGEN_RAM_ADDRESS_CMD_SIZE, size);
+		target_write_u32(target, HYDROGEN_RAM_ADDRESS_COMMAND, HYDROGEN_FLASH_COMMAND_READ_PAGE);
+		retval = hydrogen_wait_algo_done(bank, DEFAULT_TIMEOUT_ms);
+		if (retval != ERROR_OK)
+			return retval;
+
+		retval = target_read_buffer(target, HYDROGEN_RAM_ADDRESS_IMG_BUF, size, buffer);
+		if (retval != ERROR_OK)
+			return retval;
+
+		for (uint32_t i = 0; i < size; i++) {
+			if (buffer[i] != bank->erased_value) {
+				*erased = false;
+				return ERROR_OK;
+			}
+		}
+
+		count -= size;
+		offset += size;
+		keep_alive();
+	}
+
+	return ERROR_OK;
+}
+
 static int hydrogen_flash_blank_check(struct flash_bank *bank)
 {
-  //verify that all flash data are =1
+	//verify that all flash data are =1
 	struct target *target = bank->target;
+	struct hydrogen_bank *hydrogen_bank = bank->driver_priv;
 
 	int retval;
 
@@ -771,8 +838,32 @@ static int hydrogen_flash_blank_check(struct flash_bank *bank)
 	if (retval != ERROR_OK)
 		return retval;
 
+	/* The flash is only readable through the helper, so the erase check
+	 * algorithms that read memory directly cannot be used. Let the helper
+	 * check the whole flash first, which is the common case after an erase. */
+	uint32_t status;
 	target_write_u8(target,HYDROGEN_RAM_ADDRESS_COMMAND,HYDROGEN_FLASH_COMMAND_VERIFY_ALL_BLANK);
-	retval = hydrogen_wait_algo_done(bank,DEFAULT_TIMEOUT_ms);
+	retval = hydrogen_wait_algo_status(bank, HYDROGEN_FLASH_COMMAND_VERIFY_ALL_BLANK,
+			DEFAULT_TIMEOUT_ms, &status);
+
+	if (retval != ERROR_OK) {
+		/* The helper did not answer, do not keep talking to it */
+		LOG_ERROR("%s: Blank check failed", hydrogen_bank->family_name);
+	} else if (status == HYDROGEN_BUFFER_EMPTY) {
+		for (unsigned int i = 0; i < bank->num_sectors; i++)
+			bank->sectors[i].is_erased = 1;
+	} else {
+		/* Something is programmed, find out which sectors */
+		for (unsigned int i = 0; i < bank->num_sectors; i++) {
+			bool erased;
+			retval = hydrogen_sector_is_erased(bank, i, &erased);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("%s: Failed to check sector %u", hydrogen_bank->family_name, i);
+				break;
+			}
+			bank->sectors[i].is_erased = erased;
+		}
+	}
 
 		/* Regardless of errors, try to close down algo */
 		(void)hydrogen_quit(bank);
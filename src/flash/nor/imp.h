@@ -41,4 +41,21 @@ int flash_driver_verify(struct flash_bank *bank,
 int flash_write_unlock_verify(struct target *target, struct image *image,
 		uint32_t *written, bool erase, bool unlock, bool write, bool verify);
 
+/**
+ * Image data read by flash_write_unlock_verify_cached(), kept for writing the
+ * same image to further targets with the same flash layout. Start with a
+ * zeroed structure and release it with flash_image_cache_free().
+ */
+struct flash_image_cache {
+	struct flash_image_run *runs;
+	unsigned int num_runs;
+};
+
+/* like flash_write_unlock_verify(), reusing the image data and checksums
+ * in @a cache */
+int flash_write_unlock_verify_cached(struct target *target, struct image *image,
+		struct flash_image_cache *cache, uint32_t *written, bool erase,
+		bool unlock, bool write, bool verify);
+void flash_image_cache_free(struct flash_image_cache *cache);
+
 #endif /* OPENOCD_FLASH_NOR_IMP_H */
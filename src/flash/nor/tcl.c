@@ -460,6 +460,100 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 	return retval;
 }
 
+COMMAND_HANDLER(handle_flash_write_image_multi_command)
+{
+	bool auto_erase = false;
+	bool auto_unlock = false;
+	bool verify = false;
+
+	while (CMD_ARGC) {
+		if (strcmp(CMD_ARGV[0], "erase") == 0)
+			auto_erase = true;
+		else if (strcmp(CMD_ARGV[0], "unlock") == 0)
+			auto_unlock = true;
+		else if (strcmp(CMD_ARGV[0], "verify") == 0)
+			verify = true;
+		else
+			break;
+		CMD_ARGV++;
+		CMD_JIMTCL_ARGV++;
+		CMD_ARGC--;
+	}
+
+	if (CMD_ARGC < 2 || CMD_ARGC > 4)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct image image;
+	if (CMD_ARGC >= 3) {
+		image.base_address_set = true;
+		COMMAND_PARSE_NUMBER(llong, CMD_ARGV[2], image.base_address);
+	} else {
+		image.base_address_set = false;
+		image.base_address = 0x0;
+	}
+
+	image.start_address_set = false;
+
+	Jim_Interp *interp = CMD_CTX->interp;
+	const int num_targets = Jim_ListLength(interp, CMD_JIMTCL_ARGV[0]);
+	if (num_targets < 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct target **targets = calloc(num_targets, sizeof(*targets));
+	if (!targets) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	for (int i = 0; i < num_targets; i++) {
+		const char *name = Jim_GetString(Jim_ListGetIndex(interp, CMD_JIMTCL_ARGV[0], i), NULL);
+		targets[i] = get_target(name);
+		if (!targets[i]) {
+			command_print(CMD, "unknown target '%s'", name);
+			free(targets);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+	}
+
+	int retval = image_open(&image, CMD_ARGV[1], (CMD_ARGC == 4) ? CMD_ARGV[3] : NULL);
+	if (retval != ERROR_OK) {
+		free(targets);
+		return retval;
+	}
+
+	/* The image is read once, every target gets the same data */
+	struct flash_image_cache cache = { 0 };
+	int failed = 0;
+
+	for (int i = 0; i < num_targets; i++) {
+		struct duration bench;
+		uint32_t written;
+
+		duration_start(&bench);
+		retval = flash_write_unlock_verify_cached(targets[i], &image, &cache,
+			&written, auto_erase, auto_unlock, true, verify);
+		if (retval != ERROR_OK) {
+			command_print(CMD, "%s: failed", target_name(targets[i]));
+			failed++;
+			continue;
+		}
+
+		if (duration_measure(&bench) == ERROR_OK)
+			command_print(CMD, "%s: wrote %" PRIu32 " bytes%s in %fs (%0.3f KiB/s)",
+				target_name(targets[i]), written, verify ? " and verified them" : "",
+				duration_elapsed(&bench), duration_kbps(&bench, written));
+	}
+
+	flash_image_cache_free(&cache);
+	image_close(&image);
+	free(targets);
+
+	command_print(CMD, "%d of %d targets written from file %s",
+		num_targets - failed, num_targets, CMD_ARGV[1]);
+
+	return failed ? ERROR_FAIL : ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_flash_verify_image_command)
 {
 	struct target *target = get_current_target(CMD_CTX);
@@ -1313,6 +1407,14 @@ static const struct command_registration flash_exec_command_handlers[] = {
 			"and/or erase the region to be used. Allow optional "
 			"offset from beginning of bank (defaults to zero)",
 	},
+	{
+		.name = "write_image_multi",
+		.handler = handle_flash_write_image_multi_command,
+		.mode = COMMAND_EXEC,
+		.usage = "[erase] [unlock] [verify] target_list filename [offset [file_type]]",
+		.help = "Write the same image to the flash of each target in the "
+			"list. A target that fails does not stop the others.",
+	},
 	{
 		.name = "verify_image",
 		.handler = handle_flash_verify_image_command,
@@ -92,7 +92,20 @@ bool buf_eq_mask(const void *_buf1, const void *_buf2,
 
 	const uint8_t *buf1 = _buf1, *buf2 = _buf2, *mask = _mask;
 	unsigned int last = size / 8;
-	for (unsigned int i = 0; i < last; i++) {
+	unsigned int i = 0;
+
+	/* compare a word at a time, long scans are checked this way */
+	for (; i + sizeof(uint64_t) <= last; i += sizeof(uint64_t)) {
+		uint64_t a, b, m;
+
+		memcpy(&a, buf1 + i, sizeof(a));
+		memcpy(&b, buf2 + i, sizeof(b));
+		memcpy(&m, mask + i, sizeof(m));
+		if ((a ^ b) & m)
+			return false;
+	}
+
+	for (; i < last; i++) {
 		if (!buf_eq_masked(buf1[i], buf2[i], mask[i]))
 			return false;
 	}
@@ -143,6 +156,14 @@ void *buf_set_buf(const void *_src, unsigned int src_start,
 		return _dst;
 	}
 
+	/* both on byte boundary: copy whole bytes, then the remaining bits */
+	if (sq == 0 && dq == 0) {
+		memcpy(dst, src, lb);
+		uint8_t mask = (1 << lq) - 1;
+		dst[lb] = (dst[lb] & ~mask) | (src[lb] & mask);
+		return _dst;
+	}
+
 	/* fallback to slow bit copy */
 	for (i = 0; i < len; i++) {
 		if (((*src >> (sq&7)) & 1) == 1)
@@ -0,0 +1,210 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "io_trace.h"
+#include "command.h"
+#include "log.h"
+#include "replacements.h"
+
+#include <errno.h>
+#include <string.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#define IO_TRACE_DEFAULT_RECORDS	65536
+
+bool io_trace_active;
+
+static char *trace_file_name;
+static struct io_trace_header *trace_header;
+static struct io_trace_record *trace_records;
+static size_t trace_size;
+/* Slot of the next record, head % capacity */
+static uint64_t trace_slot;
+
+static uint64_t io_trace_now_us(void)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_usec;
+}
+
+void io_trace_record(enum io_trace_type type, const void *payload, size_t size)
+{
+	if (!io_trace_active)
+		return;
+
+	assert(size <= IO_TRACE_PAYLOAD_SIZE);
+
+	struct io_trace_record *record = &trace_records[trace_slot];
+	record->time_us = io_trace_now_us() - trace_header->start_us;
+	record->sequence = (uint32_t)trace_header->head;
+	record->type = type;
+	record->size = size;
+	memcpy(record->payload, payload, size);
+
+	/* The record is complete before it is counted, a trace file left
+	 * behind by a crash holds no partial record. */
+	trace_header->head++;
+	if (++trace_slot == trace_header->capacity)
+		trace_slot = 0;
+}
+
+static void *io_trace_map(const char *name, size_t size)
+{
+#ifdef HAVE_SYS_MMAN_H
+	int fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		LOG_ERROR("Cannot create I/O trace file '%s': %s", name, strerror(errno));
+		return NULL;
+	}
+
+	if (ftruncate(fd, size) != 0) {
+		LOG_ERROR("Cannot resize I/O trace file '%s': %s", name, strerror(errno));
+		close(fd);
+		return NULL;
+	}
+
+	void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		LOG_ERROR("Cannot map I/O trace file '%s': %s", name, strerror(errno));
+		return NULL;
+	}
+	return map;
+#else
+	/* Kept in memory and written to the file when the trace is stopped */
+	void *buffer = calloc(1, size);
+	if (!buffer)
+		LOG_ERROR("Out of memory");
+	return buffer;
+#endif
+}
+
+static void io_trace_unmap(void)
+{
+#ifdef HAVE_SYS_MMAN_H
+	munmap(trace_header, trace_size);
+#else
+	FILE *file = fopen(trace_file_name, "wb");
+	if (!file || fwrite(trace_header, trace_size, 1, file) != 1)
+		LOG_ERROR("Cannot write I/O trace file '%s'", trace_file_name);
+	if (file)
+		fclose(file);
+	free(trace_header);
+#endif
+}
+
+static void io_trace_stop(void)
+{
+	if (!trace_header)
+		return;
+
+	io_trace_active = false;
+	io_trace_unmap();
+	trace_header = NULL;
+	trace_records = NULL;
+	free(trace_file_name);
+	trace_file_name = NULL;
+}
+
+static int io_trace_start(const char *name, uint64_t capacity)
+{
+	io_trace_stop();
+
+	/* The file size must fit into a size_t, also on 32-bit hosts */
+	if (capacity > (SIZE_MAX - sizeof(*trace_header)) / sizeof(*trace_records)) {
+		LOG_ERROR("Too many records for an I/O trace on this host");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	trace_file_name = strdup(name);
+	if (!trace_file_name) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	size_t size = sizeof(*trace_header) + capacity * sizeof(*trace_records);
+	struct io_trace_header *header = io_trace_map(name, size);
+	if (!header) {
+		free(trace_file_name);
+		trace_file_name = NULL;
+		return ERROR_FAIL;
+	}
+
+	memcpy(header->magic, IO_TRACE_MAGIC, sizeof(header->magic));
+	header->version = IO_TRACE_VERSION;
+	header->byte_order = IO_TRACE_BYTE_ORDER;
+	header->header_size = sizeof(*header);
+	header->record_size = sizeof(*trace_records);
+	header->capacity = capacity;
+	header->head = 0;
+	header->start_us = io_trace_now_us();
+
+	trace_header = header;
+	trace_records = (struct io_trace_record *)(header + 1);
+	trace_size = size;
+	trace_slot = 0;
+	io_trace_active = true;
+	return ERROR_OK;
+}
+
+void io_trace_exit(void)
+{
+	io_trace_stop();
+}
+
+COMMAND_HANDLER(handle_io_trace_command)
+{
+	if (CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!CMD_ARGC) {
+		if (trace_header)
+			command_print(CMD, "%s, %" PRIu64 " records", trace_file_name,
+					trace_header->head);
+		else
+			command_print(CMD, "off");
+		return ERROR_OK;
+	}
+
+	if (CMD_ARGC == 1 && strcmp(CMD_ARGV[0], "off") == 0) {
+		io_trace_stop();
+		return ERROR_OK;
+	}
+
+	uint32_t capacity = IO_TRACE_DEFAULT_RECORDS;
+	if (CMD_ARGC == 2) {
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], capacity);
+		if (!capacity) {
+			command_print(CMD, "the trace must hold at least one record");
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+	}
+
+	return io_trace_start(CMD_ARGV[0], capacity);
+}
+
+static const struct command_registration io_trace_command_handlers[] = {
+	{
+		.name = "io_trace",
+		.handler = handle_io_trace_command,
+		.mode = COMMAND_ANY,
+		.help = "record adapter and target traffic to a binary ring file",
+		.usage = "[file_name [num_records] | 'off']",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int io_trace_register_commands(struct command_context *cmd_ctx)
+{
+	return register_commands(cmd_ctx, NULL, io_trace_command_handlers);
+}
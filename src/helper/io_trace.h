@@ -0,0 +1,112 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_HELPER_IO_TRACE_H
+#define OPENOCD_HELPER_IO_TRACE_H
+
+/*
+ * Binary trace of the traffic to the debug adapter and the target.
+ *
+ * The trace is a ring of fixed size records in a file that starts with a
+ * struct io_trace_header. Record i of the trace is stored in slot
+ * i % capacity, so the file always holds the most recent records. On hosts
+ * with mmap() the file is mapped and stays valid even if OpenOCD crashes.
+ *
+ * This header is also used by contrib/io_trace_decode.c and must not
+ * depend on anything else from OpenOCD.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define IO_TRACE_MAGIC		"OOCDIOTR"
+#define IO_TRACE_VERSION	1
+/* Written in host byte order, lets a decoder detect a foreign host. */
+#define IO_TRACE_BYTE_ORDER	0x01020304
+
+#define IO_TRACE_PAYLOAD_SIZE	32
+
+enum io_trace_type {
+	IO_TRACE_NONE = 0,
+	/* struct io_trace_dmi */
+	IO_TRACE_RISCV_DMI = 1,
+	/* struct io_trace_usb */
+	IO_TRACE_MPSSE_SUBMIT = 2,
+	IO_TRACE_MPSSE_COMPLETE = 3,
+};
+
+struct io_trace_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint32_t header_size;
+	uint32_t record_size;
+	/* Number of record slots in the file. */
+	uint64_t capacity;
+	/* Number of records written so far; the next one goes to slot
+	 * head % capacity. */
+	uint64_t head;
+	/* Time the trace was started, in microseconds since the epoch. */
+	uint64_t start_us;
+	uint8_t reserved[16];
+};
+
+struct io_trace_record {
+	/* Microseconds since io_trace_header.start_us. */
+	uint64_t time_us;
+	uint32_t sequence;
+	uint16_t type;
+	uint16_t size;
+	uint8_t payload[IO_TRACE_PAYLOAD_SIZE];
+};
+
+/* One DMI scan of a RISC-V target. The "in" fields hold what was shifted
+ * out of the DTM, i.e. the result of the previous scan. */
+struct io_trace_dmi {
+	uint32_t address;
+	uint32_t data_out;
+	uint32_t data_in;
+	uint32_t address_in;
+	/* DMI address of the DM the scan was sent to. */
+	uint32_t dm_base;
+	uint32_t idle;
+	/* coreid of the target the scan was done for. */
+	int16_t coreid;
+	uint8_t op_out;
+	/* 0xff if nothing was captured. */
+	uint8_t op_in;
+	uint8_t abits;
+	uint8_t reserved[3];
+};
+
+/* A USB transfer of an adapter driver. */
+struct io_trace_usb {
+	uint32_t write_count;
+	uint32_t read_count;
+	uint32_t write_transferred;
+	uint32_t read_transferred;
+	int32_t status;
+};
+
+struct command_context;
+
+extern bool io_trace_active;
+
+/** @returns true if records passed to io_trace_record() are kept. */
+static inline bool io_trace_enabled(void)
+{
+	return io_trace_active;
+}
+
+/**
+ * Appends a record of @a type to the trace. @a size must not be larger
+ * than IO_TRACE_PAYLOAD_SIZE. Check io_trace_enabled() before building the
+ * payload.
+ */
+void io_trace_record(enum io_trace_type type, const void *payload, size_t size);
+
+void io_trace_exit(void);
+
+int io_trace_register_commands(struct command_context *cmd_ctx);
+
+#endif /* OPENOCD_HELPER_IO_TRACE_H */
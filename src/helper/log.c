@@ -22,6 +22,7 @@
 #include <server/gdb_server.h>
 #include <server/server.h>
 
+#include <signal.h>
 #include <stdarg.h>
 
 #ifdef _DEBUG_FREE_SPACE_
@@ -77,6 +78,99 @@ static void log_forward(const char *file, unsigned int line, const char *functio
 	}
 }
 
+/* Output to a log file is fully buffered in log_file_buffer and written out
+ * in batches; writing and flushing it for every message of a debug log slows
+ * everything else down. Errors and warnings are flushed immediately, the rest
+ * at most LOG_FLUSH_INTERVAL_MS later or when the server loop goes idle. The
+ * buffer is fixed, so a burst of messages cannot grow memory use. Output to
+ * stderr is still flushed for every message. If OpenOCD crashes, the buffer
+ * is flushed by log_crash_handler(); abort() is handled by the server's
+ * SIGABRT handler.
+ */
+#define LOG_FILE_BUFFER_SIZE	(64 * 1024)
+#define LOG_FLUSH_INTERVAL_MS	100
+
+static char log_file_buffer[LOG_FILE_BUFFER_SIZE];
+static int64_t last_flush;
+
+void log_flush(void)
+{
+	if (!log_output)
+		return;
+
+	fflush(log_output);
+	last_flush = timeval_ms();
+}
+
+static void log_flush_message(enum log_levels level)
+{
+	if (log_output == stderr || level <= LOG_LVL_WARNING
+			|| timeval_ms() - last_flush >= LOG_FLUSH_INTERVAL_MS)
+		log_flush();
+}
+
+/* fflush() is not async-signal-safe, but the process is about to die and
+ * the end of the log is what tells why. */
+static void log_crash_handler(int sig)
+{
+	if (log_output)
+		fflush(log_output);
+
+	/* Die from the same signal once the handler returns */
+	signal(sig, SIG_DFL);
+	raise(sig);
+}
+
+static void log_catch_crashes(void)
+{
+	static bool installed;
+
+	if (installed)
+		return;
+
+	signal(SIGSEGV, log_crash_handler);
+	signal(SIGILL, log_crash_handler);
+	signal(SIGFPE, log_crash_handler);
+#ifdef SIGBUS
+	signal(SIGBUS, log_crash_handler);
+#endif
+	installed = true;
+}
+
+static const char *log_basename(const char *file)
+{
+	const char *f = strrchr(file, '/');
+
+	return f ? f + 1 : file;
+}
+
+static void log_puts_header(enum log_levels level,
+	const char *file,
+	int line,
+	const char *function)
+{
+	if (LOG_LEVEL_IS(LOG_LVL_DEBUG)) {
+		/* print with count and time information */
+		int64_t t = timeval_ms() - start;
+#ifdef _DEBUG_FREE_SPACE_
+		struct mallinfo2 info = mallinfo2();
+#endif
+		fprintf(log_output, "%s%d %" PRId64 " %s:%d %s()"
+#ifdef _DEBUG_FREE_SPACE_
+			FORDBLKS_FORMAT
+#endif
+			": ", log_strings[level + 1], count, t, file, line, function
+#ifdef _DEBUG_FREE_SPACE_
+			, info.fordblks
+#endif
+			);
+	} else if (level > LOG_LVL_USER) {
+		/* if we are using gdb through pipes then we do not want any output
+		 * to the pipe otherwise we get repeated strings */
+		fputs(log_strings[level + 1], log_output);
+	}
+}
+
 /* The log_puts() serves two somewhat different goals:
  *
  * - logging
@@ -93,8 +187,6 @@ static void log_puts(enum log_levels level,
 	const char *function,
 	const char *string)
 {
-	char *f;
-
 	if (!log_output) {
 		/* log_init() not called yet; print on stderr */
 		fputs(string, stderr);
@@ -105,43 +197,45 @@ static void log_puts(enum log_levels level,
 	if (level == LOG_LVL_OUTPUT) {
 		/* do not prepend any headers, just print out what we were given and return */
 		fputs(string, log_output);
-		fflush(log_output);
+		log_flush();
 		return;
 	}
 
-	f = strrchr(file, '/');
-	if (f)
-		file = f + 1;
+	file = log_basename(file);
 
-	if (LOG_LEVEL_IS(LOG_LVL_DEBUG)) {
-		/* print with count and time information */
-		int64_t t = timeval_ms() - start;
-#ifdef _DEBUG_FREE_SPACE_
-		struct mallinfo2 info = mallinfo2();
-#endif
-		fprintf(log_output, "%s%d %" PRId64 " %s:%d %s()"
-#ifdef _DEBUG_FREE_SPACE_
-			FORDBLKS_FORMAT
-#endif
-			": %s", log_strings[level + 1], count, t, file, line, function,
-#ifdef _DEBUG_FREE_SPACE_
-			info.fordblks,
-#endif
-			string);
-	} else {
-		/* if we are using gdb through pipes then we do not want any output
-		 * to the pipe otherwise we get repeated strings */
-		fprintf(log_output, "%s%s",
-			(level > LOG_LVL_USER) ? log_strings[level + 1] : "", string);
-	}
+	log_puts_header(level, file, line, function);
+	fputs(string, log_output);
 
-	fflush(log_output);
+	log_flush_message(level);
 
 	/* Never forward LOG_LVL_DEBUG, too verbose and they can be found in the log if need be */
 	if (level <= LOG_LVL_INFO)
 		log_forward(file, line, function, string);
 }
 
+/* Debug messages are never forwarded, so when they go to a log file they are
+ * formatted straight into its buffer instead of into a temporary string. */
+static bool log_direct(enum log_levels level)
+{
+	return log_output && log_output != stderr && level >= LOG_LVL_DEBUG;
+}
+
+static void log_vputs_direct(enum log_levels level,
+	const char *file,
+	int line,
+	const char *function,
+	const char *format,
+	va_list args,
+	bool newline)
+{
+	log_puts_header(level, log_basename(file), line, function);
+	vfprintf(log_output, format, args);
+	if (newline)
+		fputc('\n', log_output);
+
+	log_flush_message(level);
+}
+
 void log_printf(enum log_levels level,
 	const char *file,
 	unsigned int line,
@@ -158,10 +252,14 @@ void log_printf(enum log_levels level,
 
 	va_start(ap, format);
 
-	string = alloc_vprintf(format, ap);
-	if (string) {
-		log_puts(level, file, line, function, string);
-		free(string);
+	if (log_direct(level)) {
+		log_vputs_direct(level, file, line, function, format, ap, false);
+	} else {
+		string = alloc_vprintf(format, ap);
+		if (string) {
+			log_puts(level, file, line, function, string);
+			free(string);
+		}
 	}
 
 	va_end(ap);
@@ -177,6 +275,11 @@ void log_vprintf_lf(enum log_levels level, const char *file, unsigned int line,
 	if (level > debug_level)
 		return;
 
+	if (log_direct(level)) {
+		log_vputs_direct(level, file, line, function, format, args, true);
+		return;
+	}
+
 	tmp = alloc_vprintf(format, args);
 
 	if (!tmp)
@@ -246,7 +349,13 @@ COMMAND_HANDLER(handle_log_output_command)
 		/* Close previous log file, if it was open and wasn't stderr. */
 		fclose(log_output);
 	}
+	/* The previous log file is closed, so its buffer can be reused. */
+	if (file != stderr) {
+		setvbuf(file, log_file_buffer, _IOFBF, sizeof(log_file_buffer));
+		log_catch_crashes();
+	}
 	log_output = file;
+	last_flush = timeval_ms();
 	return ERROR_OK;
 }
 
@@ -294,6 +403,7 @@ void log_init(void)
 		log_output = stderr;
 
 	start = last_time = timeval_ms();
+	last_flush = start;
 }
 
 void log_exit(void)
@@ -192,25 +192,12 @@ static int bitbang_stableclocks(unsigned int num_cycles)
 	return ERROR_OK;
 }
 
-static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
+/* Shift the bits one by one, TMS is high on the last bit */
+static int bitbang_scan_bits(enum scan_type type, uint8_t *buffer,
 		unsigned int scan_size)
 {
-	enum tap_state saved_end_state = tap_get_end_state();
 	unsigned int bit_cnt;
 
-	if (!((!ir_scan &&
-			(tap_get_state() == TAP_DRSHIFT)) ||
-			(ir_scan && (tap_get_state() == TAP_IRSHIFT)))) {
-		if (ir_scan)
-			bitbang_end_state(TAP_IRSHIFT);
-		else
-			bitbang_end_state(TAP_DRSHIFT);
-
-		if (bitbang_state_move(0) != ERROR_OK)
-			return ERROR_FAIL;
-		bitbang_end_state(saved_end_state);
-	}
-
 	size_t buffered = 0;
 	for (bit_cnt = 0; bit_cnt < scan_size; bit_cnt++) {
 		int tms = (bit_cnt == scan_size-1) ? 1 : 0;
@@ -270,8 +257,37 @@ static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
 		}
 	}
 
+	return ERROR_OK;
+}
+
+static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
+		unsigned int scan_size)
+{
+	enum tap_state saved_end_state = tap_get_end_state();
+
+	if (!((!ir_scan &&
+			(tap_get_state() == TAP_DRSHIFT)) ||
+			(ir_scan && (tap_get_state() == TAP_IRSHIFT)))) {
+		if (ir_scan)
+			bitbang_end_state(TAP_IRSHIFT);
+		else
+			bitbang_end_state(TAP_DRSHIFT);
+
+		if (bitbang_state_move(0) != ERROR_OK)
+			return ERROR_FAIL;
+		bitbang_end_state(saved_end_state);
+	}
+
+	if (bitbang_interface->block_scan) {
+		if (bitbang_interface->block_scan(type != SCAN_IN ? buffer : NULL,
+				type != SCAN_OUT ? buffer : NULL, scan_size) != ERROR_OK)
+			return ERROR_FAIL;
+	} else if (bitbang_scan_bits(type, buffer, scan_size) != ERROR_OK) {
+		return ERROR_FAIL;
+	}
+
 	if (tap_get_state() != tap_get_end_state()) {
-		/* we *KNOW* the above loop transitioned out of
+		/* we *KNOW* the above scan transitioned out of
 		 * the shift state, so we skip the first state
 		 * and move directly to the end state.
 		 */
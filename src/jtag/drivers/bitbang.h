@@ -44,6 +44,14 @@ struct bitbang_interface {
 	/** Set TCK, TMS, and TDI to the given values. */
 	int (*write)(int tck, int tms, int tdi);
 
+	/** Shift a whole vector of bits (optional).
+	 *
+	 * Equivalent to write(0, tms, tdi), sampling TDO and write(1, tms, tdi)
+	 * for every bit, with TMS high on the last bit only. TDI is taken from
+	 * out, or is low if out is NULL. TDO is stored into in, unless in is
+	 * NULL. out and in may point to the same buffer. */
+	int (*block_scan)(const uint8_t *out, uint8_t *in, unsigned int bit_cnt);
+
 	/** Blink led (optional). */
 	int (*blink)(bool on);
 
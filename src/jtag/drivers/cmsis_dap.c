@@ -1004,11 +1004,22 @@ skip:
 	dap->pending_fifo_block_count--;
 }
 
+/* Process all responses which have already arrived without waiting for more */
+static void cmsis_dap_swd_read_completed(struct cmsis_dap *dap)
+{
+	while (dap->pending_fifo_block_count) {
+		unsigned int block_count = dap->pending_fifo_block_count;
+
+		cmsis_dap_swd_read_process(dap, CMSIS_DAP_NON_BLOCKING);
+		if (dap->pending_fifo_block_count == block_count)
+			break;
+	}
+}
+
 static int cmsis_dap_swd_run_queue(void)
 {
 	if (cmsis_dap_handle->write_count + cmsis_dap_handle->read_count) {
-		if (cmsis_dap_handle->pending_fifo_block_count)
-			cmsis_dap_swd_read_process(cmsis_dap_handle, CMSIS_DAP_NON_BLOCKING);
+		cmsis_dap_swd_read_completed(cmsis_dap_handle);
 
 		cmsis_dap_swd_write_from_queue(cmsis_dap_handle);
 	}
@@ -1089,8 +1100,7 @@ static void cmsis_dap_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data)
 	if (cmd_size > tfer_max_command_size
 			|| resp_size > tfer_max_response_size
 			|| write_count + read_count > max_transfer_count) {
-		if (cmsis_dap_handle->pending_fifo_block_count)
-			cmsis_dap_swd_read_process(cmsis_dap_handle, CMSIS_DAP_NON_BLOCKING);
+		cmsis_dap_swd_read_completed(cmsis_dap_handle);
 
 		/* Not enough room in the queue. Run the queue. */
 		cmsis_dap_swd_write_from_queue(cmsis_dap_handle);
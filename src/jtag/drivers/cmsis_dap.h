@@ -15,8 +15,10 @@ struct pending_transfer_result {
 };
 
 /* Up to MIN(packet_count, MAX_PENDING_REQUESTS) requests may be issued
- * until the first response arrives */
-#define MAX_PENDING_REQUESTS 4
+ * until the first response arrives. High speed CMSIS-DAP v2 probes report
+ * packet counts well above 4, keeping that many requests in flight hides
+ * the USB round trip time */
+#define MAX_PENDING_REQUESTS 32
 
 struct pending_request_block {
 	struct pending_transfer_result *transfers;
@@ -62,6 +62,8 @@ static int cmsis_dap_usb_interface = -1;
 static void cmsis_dap_usb_close(struct cmsis_dap *dap);
 static int cmsis_dap_usb_alloc(struct cmsis_dap *dap, unsigned int pkt_sz);
 static void cmsis_dap_usb_free(struct cmsis_dap *dap);
+static void cmsis_dap_usb_cancel_transfer(struct cmsis_dap *dap,
+										  struct cmsis_dap_bulk_transfer *tr);
 
 static int cmsis_dap_usb_open(struct cmsis_dap *dap, uint16_t vids[], uint16_t pids[], const char *serial)
 {
@@ -427,6 +429,8 @@ static void cmsis_dap_usb_close(struct cmsis_dap *dap)
 		} else {
 			libusb_free_transfer(dap->bdata->command_transfers[i].transfer);
 		}
+		/* Responses are read ahead, a read may be pending without a command */
+		cmsis_dap_usb_cancel_transfer(dap, &dap->bdata->response_transfers[i]);
 		libusb_free_transfer(dap->bdata->response_transfers[i].transfer);
 	}
 	cmsis_dap_usb_free(dap);
@@ -452,6 +456,45 @@ static void LIBUSB_CALL cmsis_dap_usb_callback(struct libusb_transfer *transfer)
 	}
 }
 
+/* Cancel a pending transfer and wait until libusb gives it back */
+static void cmsis_dap_usb_cancel_transfer(struct cmsis_dap *dap,
+										  struct cmsis_dap_bulk_transfer *tr)
+{
+	if (tr->transfer && tr->status == CMSIS_DAP_TRANSFER_PENDING) {
+		struct timeval tv = {
+			.tv_sec = 1,
+			.tv_usec = 0
+		};
+
+		libusb_cancel_transfer(tr->transfer);
+		int err = libusb_handle_events_timeout_completed(dap->bdata->usb_ctx,
+														 &tv, &tr->status);
+		if (err)
+			LOG_ERROR("error handling USB events: %s", libusb_strerror(err));
+	}
+
+	tr->status = CMSIS_DAP_TRANSFER_IDLE;
+}
+
+static int cmsis_dap_usb_submit_read(struct cmsis_dap *dap,
+									 struct cmsis_dap_bulk_transfer *tr, int timeout_ms)
+{
+	libusb_fill_bulk_transfer(tr->transfer,
+							  dap->bdata->dev_handle, dap->bdata->ep_in,
+							  tr->buffer, dap->packet_size,
+							  &cmsis_dap_usb_callback, tr,
+							  timeout_ms);
+	tr->status = CMSIS_DAP_TRANSFER_PENDING;
+	int err = libusb_submit_transfer(tr->transfer);
+	if (err) {
+		tr->status = CMSIS_DAP_TRANSFER_IDLE;
+		LOG_ERROR("error submitting USB read: %s", libusb_strerror(err));
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
 static int cmsis_dap_usb_read(struct cmsis_dap *dap, int transfer_timeout_ms,
 							  enum cmsis_dap_blocking blocking)
 {
@@ -460,20 +503,13 @@ static int cmsis_dap_usb_read(struct cmsis_dap *dap, int transfer_timeout_ms,
 	struct cmsis_dap_bulk_transfer *tr;
 	tr = &dap->bdata->response_transfers[dap->pending_fifo_get_idx];
 
+	/* The response transfer is normally submitted together with its command,
+	 * submit it here only if there was no command (flushing stale packets) */
 	if (tr->status == CMSIS_DAP_TRANSFER_IDLE) {
-		libusb_fill_bulk_transfer(tr->transfer,
-								  dap->bdata->dev_handle, dap->bdata->ep_in,
-								  tr->buffer, dap->packet_size,
-								  &cmsis_dap_usb_callback, tr,
-								  transfer_timeout_ms);
 		LOG_DEBUG_IO("submit read @ %u", dap->pending_fifo_get_idx);
-		tr->status = CMSIS_DAP_TRANSFER_PENDING;
-		err = libusb_submit_transfer(tr->transfer);
-		if (err) {
-			tr->status = CMSIS_DAP_TRANSFER_IDLE;
-			LOG_ERROR("error submitting USB read: %s", libusb_strerror(err));
-			return ERROR_FAIL;
-		}
+		err = cmsis_dap_usb_submit_read(dap, tr, transfer_timeout_ms);
+		if (err != ERROR_OK)
+			return err;
 	}
 
 	struct timeval tv;
@@ -589,6 +625,20 @@ static int cmsis_dap_usb_write(struct cmsis_dap *dap, int txlen, int timeout_ms)
 		return ERROR_FAIL;
 	}
 
+	/* Queue the read of the response right away. With a read pending for
+	 * every command in flight, the probe can return responses back to back
+	 * and the queue executor only reaps completed transfers. */
+	tr = &dap->bdata->response_transfers[dap->pending_fifo_put_idx];
+	if (tr->status != CMSIS_DAP_TRANSFER_IDLE) {
+		/* Left over from a flushed pipeline, the response is stale */
+		LOG_DEBUG("stale response USB transfer at %u", dap->pending_fifo_put_idx);
+		cmsis_dap_usb_cancel_transfer(dap, tr);
+	}
+
+	LOG_DEBUG_IO("submit read @ %u", dap->pending_fifo_put_idx);
+	/* On failure the read is submitted again when the response is requested */
+	cmsis_dap_usb_submit_read(dap, tr, timeout_ms);
+
 	return ERROR_OK;
 }
 
@@ -647,13 +697,8 @@ static void cmsis_dap_usb_free(struct cmsis_dap *dap)
 static void cmsis_dap_usb_cancel_all(struct cmsis_dap *dap)
 {
 	for (unsigned int i = 0; i < MAX_PENDING_REQUESTS; i++) {
-		if (dap->bdata->command_transfers[i].status == CMSIS_DAP_TRANSFER_PENDING)
-			libusb_cancel_transfer(dap->bdata->command_transfers[i].transfer);
-		if (dap->bdata->response_transfers[i].status == CMSIS_DAP_TRANSFER_PENDING)
-			libusb_cancel_transfer(dap->bdata->response_transfers[i].transfer);
-
-		dap->bdata->command_transfers[i].status = CMSIS_DAP_TRANSFER_IDLE;
-		dap->bdata->response_transfers[i].status = CMSIS_DAP_TRANSFER_IDLE;
+		cmsis_dap_usb_cancel_transfer(dap, &dap->bdata->command_transfers[i]);
+		cmsis_dap_usb_cancel_transfer(dap, &dap->bdata->response_transfers[i]);
 	}
 }
 
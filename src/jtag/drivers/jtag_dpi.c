@@ -24,9 +24,29 @@
 #include <netinet/tcp.h>
 #endif
 
+#include "helper/replacements.h"
+
 #define SERVER_ADDRESS	"127.0.0.1"
 #define SERVER_PORT	5555
 
+/* Protocol versions announced by the server in reply to "version\n" */
+#define DPI_VERSION_LEGACY	0
+#define DPI_VERSION_BULK	1
+/* Servers which do not answer within this time are assumed to be legacy */
+#define DPI_VERSION_TIMEOUT_MS	500
+
+/* Bulk record operations */
+#define DPI_OP_RESET		0
+#define DPI_OP_IR_SCAN		1
+#define DPI_OP_DR_SCAN		2
+
+/* Bulk record flag: the server shall return the TDO data of this record */
+#define DPI_BULK_CAPTURE	0x01
+/* op, flags and 32-bit bit count */
+#define DPI_BULK_RECORD_HEADER	6
+/* Send a bulk frame early once it grows beyond this size */
+#define DPI_BULK_FRAME_MAX	(1024 * 1024)
+
 static uint16_t server_port = SERVER_PORT;
 static char *server_address;
 
@@ -36,6 +56,29 @@ static struct sockaddr_in serv_addr;
 static uint8_t *last_ir_buf;
 static int last_ir_num_bits;
 
+/* Protocol version of the server, DPI_VERSION_LEGACY for old servers */
+static unsigned int server_version;
+
+struct jtag_dpi_capture {
+	struct scan_command *cmd;
+	/* scan buffer, receives the TDO data and is freed afterwards */
+	uint8_t *buf;
+	int bytes;
+};
+
+/*
+ * Commands collected for the next bulk frame. The frame is sent as a whole,
+ * then the TDO data of all capturing records is read back in one go.
+ */
+static struct {
+	uint8_t *data;
+	size_t size;
+	size_t used;
+	struct jtag_dpi_capture *captures;
+	unsigned int num_captures;
+	unsigned int max_captures;
+} bulk;
+
 static int write_sock(char *buf, size_t len)
 {
 	if (!buf) {
@@ -43,10 +86,17 @@ static int write_sock(char *buf, size_t len)
 			__func__, __FILE__, __LINE__);
 		return ERROR_FAIL;
 	}
-	if (write(sockfd, buf, len) != (ssize_t)len) {
-		LOG_ERROR("%s: %s, file %s, line %d", __func__,
-			strerror(errno), __FILE__, __LINE__);
-		return ERROR_FAIL;
+	while (len > 0) {
+		ssize_t ret = write(sockfd, buf, len);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			LOG_ERROR("%s: %s, file %s, line %d", __func__,
+				strerror(errno), __FILE__, __LINE__);
+			return ERROR_FAIL;
+		}
+		buf += ret;
+		len -= ret;
 	}
 	return ERROR_OK;
 }
@@ -58,14 +108,135 @@ static int read_sock(char *buf, size_t len)
 			__func__, __FILE__, __LINE__);
 		return ERROR_FAIL;
 	}
-	if (read(sockfd, buf, len) != (ssize_t)len) {
-		LOG_ERROR("%s: %s, file %s, line %d", __func__,
-			strerror(errno), __FILE__, __LINE__);
-		return ERROR_FAIL;
+	while (len > 0) {
+		ssize_t ret = read(sockfd, buf, len);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			LOG_ERROR("%s: %s, file %s, line %d", __func__,
+				ret ? strerror(errno) : "connection closed",
+				__FILE__, __LINE__);
+			return ERROR_FAIL;
+		}
+		buf += ret;
+		len -= ret;
+	}
+	return ERROR_OK;
+}
+
+/**
+ * jtag_dpi_bulk_append - add one record to the next bulk frame
+ * @param op DPI_OP_RESET, DPI_OP_IR_SCAN or DPI_OP_DR_SCAN
+ * @param bits TDI bits
+ * @param num_bits number of bits
+ * @param flags DPI_BULK_CAPTURE if the TDO data is to be returned
+ */
+static int jtag_dpi_bulk_append(uint8_t op, const uint8_t *bits, int num_bits,
+	uint8_t flags)
+{
+	int bytes = DIV_ROUND_UP(num_bits, 8);
+	size_t len = DPI_BULK_RECORD_HEADER + bytes;
+
+	if (bulk.used + len > bulk.size) {
+		size_t size = MAX(bulk.size * 2, bulk.used + len);
+		uint8_t *data = realloc(bulk.data, size);
+		if (!data) {
+			LOG_ERROR("%s: realloc fail, file %s, line %d",
+				__func__, __FILE__, __LINE__);
+			return ERROR_FAIL;
+		}
+		bulk.data = data;
+		bulk.size = size;
 	}
+
+	uint8_t *record = bulk.data + bulk.used;
+	record[0] = op;
+	record[1] = flags;
+	h_u32_to_le(record + 2, num_bits);
+	if (bytes)
+		memcpy(record + DPI_BULK_RECORD_HEADER, bits, bytes);
+
+	bulk.used += len;
 	return ERROR_OK;
 }
 
+/**
+ * jtag_dpi_bulk_capture - complete a scan once the bulk frame is sent
+ * @param cmd the scan command
+ * @param buf scan buffer, owned by the bulk frame from now on
+ * @param bytes number of TDO bytes returned for the scan
+ */
+static int jtag_dpi_bulk_capture(struct scan_command *cmd, uint8_t *buf, int bytes)
+{
+	if (bulk.num_captures == bulk.max_captures) {
+		unsigned int max_captures = MAX(bulk.max_captures * 2, 16);
+		struct jtag_dpi_capture *captures = realloc(bulk.captures,
+			max_captures * sizeof(*captures));
+		if (!captures) {
+			LOG_ERROR("%s: realloc fail, file %s, line %d",
+				__func__, __FILE__, __LINE__);
+			free(buf);
+			return ERROR_FAIL;
+		}
+		bulk.captures = captures;
+		bulk.max_captures = max_captures;
+	}
+
+	bulk.captures[bulk.num_captures].cmd = cmd;
+	bulk.captures[bulk.num_captures].buf = buf;
+	bulk.captures[bulk.num_captures].bytes = bytes;
+	bulk.num_captures++;
+
+	return ERROR_OK;
+}
+
+static void jtag_dpi_bulk_discard(void)
+{
+	for (unsigned int i = 0; i < bulk.num_captures; i++)
+		free(bulk.captures[i].buf);
+
+	bulk.num_captures = 0;
+	bulk.used = 0;
+}
+
+/**
+ * jtag_dpi_bulk_flush - send the collected bulk frame
+ *
+ * The frame is sent as "bulk <length>\n" followed by the records. The server
+ * answers with the TDO data of the records flagged DPI_BULK_CAPTURE,
+ * concatenated in order.
+ */
+static int jtag_dpi_bulk_flush(void)
+{
+	char buf[24];
+	int ret;
+
+	if (!bulk.used)
+		return ERROR_OK;
+
+	LOG_DEBUG_IO("JTAG DRIVER DEBUG: bulk frame of %zu bytes, %u captures",
+		bulk.used, bulk.num_captures);
+
+	snprintf(buf, sizeof(buf), "bulk %zu\n", bulk.used);
+	ret = write_sock(buf, strlen(buf));
+	if (ret == ERROR_OK)
+		ret = write_sock((char *)bulk.data, bulk.used);
+
+	for (unsigned int i = 0; ret == ERROR_OK && i < bulk.num_captures; i++) {
+		struct jtag_dpi_capture *capture = &bulk.captures[i];
+
+		ret = read_sock((char *)capture->buf, capture->bytes);
+		if (ret == ERROR_OK)
+			ret = jtag_read_buffer(capture->buf, capture->cmd);
+	}
+	if (ret != ERROR_OK)
+		LOG_ERROR("bulk frame fail, file %s, line %d", __FILE__, __LINE__);
+
+	jtag_dpi_bulk_discard();
+
+	return ret;
+}
+
 /**
  * jtag_dpi_reset - ask to reset the JTAG device
  * @param trst 1 if TRST is to be asserted
@@ -78,7 +249,11 @@ static int jtag_dpi_reset(int trst, int srst)
 
 	LOG_DEBUG_IO("JTAG DRIVER DEBUG: reset trst: %i srst %i", trst, srst);
 
-	if (trst == 1) {
+	if (trst == 1 && server_version >= DPI_VERSION_BULK) {
+		ret = jtag_dpi_bulk_append(DPI_OP_RESET, NULL, 0, 0);
+		if (ret == ERROR_OK)
+			ret = jtag_dpi_bulk_flush();
+	} else if (trst == 1) {
 		/* reset the JTAG TAP controller */
 		ret = write_sock(buf, strlen(buf));
 		if (ret != ERROR_OK) {
@@ -131,6 +306,16 @@ static int jtag_dpi_scan(struct scan_command *cmd)
 		memcpy(last_ir_buf, data_buf, bytes);
 		last_ir_num_bits = num_bits;
 	}
+
+	if (server_version >= DPI_VERSION_BULK) {
+		ret = jtag_dpi_bulk_append(cmd->ir_scan ? DPI_OP_IR_SCAN : DPI_OP_DR_SCAN,
+			data_buf, num_bits, DPI_BULK_CAPTURE);
+		if (ret != ERROR_OK)
+			goto out;
+		/* completed by jtag_dpi_bulk_flush() */
+		return jtag_dpi_bulk_capture(cmd, data_buf, bytes);
+	}
+
 	snprintf(buf, sizeof(buf), "%s %d\n", cmd->ir_scan ? "ib" : "db", num_bits);
 	ret = write_sock(buf, strlen(buf));
 	if (ret != ERROR_OK) {
@@ -181,6 +366,16 @@ static int jtag_dpi_runtest(unsigned int num_cycles)
 		return ERROR_FAIL;
 	}
 
+	if (server_version >= DPI_VERSION_BULK) {
+		while (num_cycles > 0) {
+			ret = jtag_dpi_bulk_append(DPI_OP_IR_SCAN, data_buf, num_bits, 0);
+			if (ret != ERROR_OK)
+				return ret;
+			num_cycles -= MIN(num_cycles, (unsigned int)num_bits + 6);
+		}
+		return ERROR_OK;
+	}
+
 	bytes = DIV_ROUND_UP(num_bits, 8);
 	read_scan = (uint8_t *)malloc(bytes * sizeof(uint8_t));
 	if (!read_scan) {
@@ -248,6 +443,7 @@ static int jtag_dpi_execute_queue(struct jtag_command *cmd_queue)
 			/* unsupported */
 			break;
 		case JTAG_SLEEP:
+			ret = jtag_dpi_bulk_flush();
 			jtag_sleep(cmd->cmd.sleep->us);
 			break;
 		case JTAG_SCAN:
@@ -259,11 +455,73 @@ static int jtag_dpi_execute_queue(struct jtag_command *cmd_queue)
 			ret = ERROR_FAIL;
 			break;
 		}
+
+		if (ret == ERROR_OK && bulk.used >= DPI_BULK_FRAME_MAX)
+			ret = jtag_dpi_bulk_flush();
 	}
 
+	if (ret == ERROR_OK)
+		ret = jtag_dpi_bulk_flush();
+	else
+		jtag_dpi_bulk_discard();
+
 	return ret;
 }
 
+/**
+ * jtag_dpi_get_version - negotiate the protocol version with the server
+ *
+ * Newer servers answer "version\n" with "version <n>\n". Older servers do
+ * not answer at all, so a missing reply selects the legacy protocol.
+ */
+static int jtag_dpi_get_version(void)
+{
+	char *buf = "version\n";
+	char reply[32];
+	unsigned int len = 0;
+	int ret;
+
+	server_version = DPI_VERSION_LEGACY;
+
+	ret = write_sock(buf, strlen(buf));
+	if (ret != ERROR_OK)
+		return ret;
+
+	while (len < sizeof(reply) - 1) {
+		struct timeval tv = {
+			.tv_sec = 0,
+			.tv_usec = DPI_VERSION_TIMEOUT_MS * 1000,
+		};
+		fd_set rfds;
+
+		FD_ZERO(&rfds);
+		FD_SET(sockfd, &rfds);
+		ret = socket_select(sockfd + 1, &rfds, NULL, NULL, &tv);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			break;
+
+		ret = read_sock(&reply[len], 1);
+		if (ret != ERROR_OK)
+			return ret;
+		if (reply[len] == '\n')
+			break;
+		len++;
+	}
+	reply[len] = '\0';
+
+	if (len == 0)
+		return ERROR_OK;
+
+	if (sscanf(reply, "version %u", &server_version) != 1) {
+		LOG_ERROR("Unexpected reply '%s' to the version request", reply);
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
 static int jtag_dpi_init(void)
 {
 	sockfd = socket(AF_INET, SOCK_STREAM, 0);
@@ -309,6 +567,15 @@ static int jtag_dpi_init(void)
 
 	LOG_INFO("Connection to %s : %" PRIu16 " succeed", server_address, server_port);
 
+	int ret = jtag_dpi_get_version();
+	if (ret != ERROR_OK)
+		return ret;
+
+	if (server_version >= DPI_VERSION_BULK)
+		LOG_INFO("DPI server protocol version %u, using bulk frames", server_version);
+	else
+		LOG_INFO("Legacy DPI server, sending one scan at a time");
+
 	return ERROR_OK;
 }
 
@@ -316,6 +583,10 @@ static int jtag_dpi_quit(void)
 {
 	free(server_address);
 	server_address = NULL;
+	free(bulk.data);
+	bulk.data = NULL;
+	free(bulk.captures);
+	bulk.captures = NULL;
 
 	return close(sockfd);
 }
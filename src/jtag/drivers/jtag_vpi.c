@@ -37,6 +37,19 @@
 #define CMD_SCAN_CHAIN		2
 #define CMD_SCAN_CHAIN_FLIP_TMS	3
 #define CMD_STOP_SIMU		4
+#define CMD_BULK		5
+
+/* Protocol versions announced by the server in reply to the version probe */
+#define JTAG_VPI_VERSION_LEGACY	0
+#define JTAG_VPI_VERSION_BULK	1
+#define JTAG_VPI_VERSION_MAGIC	"VPIv"
+
+/* Bulk record flag: the server shall return the TDO data of this record */
+#define BULK_CAPTURE		0x01
+/* op, flags and 32-bit bit count */
+#define BULK_RECORD_HEADER	6
+/* Send a bulk frame early once it grows beyond this size */
+#define BULK_FRAME_MAX		(1024 * 1024)
 
 /* jtag_vpi server port and address to connect to */
 static int server_port = DEFAULT_SERVER_PORT;
@@ -48,6 +61,29 @@ static bool stop_sim_on_exit;
 static int sockfd;
 static struct sockaddr_in serv_addr;
 
+/* Protocol version of the server, JTAG_VPI_VERSION_LEGACY for old servers */
+static unsigned int server_version;
+
+struct jtag_vpi_capture {
+	struct scan_command *cmd;
+	/* scan buffer, receives the TDO data and is freed afterwards */
+	uint8_t *buf;
+	unsigned int nb_bytes;
+};
+
+/*
+ * Commands collected for the next bulk frame. The frame is sent as a whole,
+ * then the TDO data of all capturing records is read back in one go.
+ */
+static struct {
+	uint8_t *data;
+	size_t size;
+	size_t used;
+	struct jtag_vpi_capture *captures;
+	unsigned int num_captures;
+	unsigned int max_captures;
+} bulk;
+
 /* One jtag_vpi "packet" as sent over a TCP channel. */
 struct vpi_cmd {
 	union {
@@ -79,15 +115,84 @@ static char *jtag_vpi_cmd_to_str(int cmd_num)
 		return "CMD_SCAN_CHAIN_FLIP_TMS";
 	case CMD_STOP_SIMU:
 		return "CMD_STOP_SIMU";
+	case CMD_BULK:
+		return "CMD_BULK";
 	default:
 		return "<unknown>";
 	}
 }
 
-static int jtag_vpi_send_cmd(struct vpi_cmd *vpi)
+static int jtag_vpi_write(const void *data, size_t len)
 {
-	int retval;
+	size_t bytes_sent = 0;
+
+	while (bytes_sent < len) {
+		int retval = write_socket(sockfd, (const char *)data + bytes_sent, len - bytes_sent);
+		if (retval < 0) {
+			/* Account for the case when socket write is interrupted. */
+#ifdef _WIN32
+			int wsa_err = WSAGetLastError();
+			if (wsa_err == WSAEINTR)
+				continue;
+#else
+			if (errno == EINTR)
+				continue;
+#endif
+			/* Otherwise this is an error using the socket, most likely fatal
+			   for the connection. */
+			log_socket_error("jtag_vpi xmit");
+			/* TODO: Clean way how adapter drivers can report fatal errors
+			   to upper layers of OpenOCD and let it perform an orderly shutdown? */
+			exit(-1);
+		} else if (retval == 0) {
+			/* This means we could not send all data, which is most likely fatal
+			   for the jtag_vpi connection (the underlying TCP connection likely not
+			   usable anymore) */
+			LOG_ERROR("jtag_vpi: Could not send all data through jtag_vpi connection.");
+			exit(-1);
+		}
+		bytes_sent += retval;
+	}
 
+	return ERROR_OK;
+}
+
+static int jtag_vpi_read(void *data, size_t len)
+{
+	size_t bytes_buffered = 0;
+
+	while (bytes_buffered < len) {
+		int retval = read_socket(sockfd, (char *)data + bytes_buffered, len - bytes_buffered);
+		if (retval < 0) {
+#ifdef _WIN32
+			int wsa_err = WSAGetLastError();
+			if (wsa_err == WSAEINTR) {
+				/* socket read interrupted by WSACancelBlockingCall() */
+				continue;
+			}
+#else
+			if (errno == EINTR) {
+				/* socket read interrupted by a signal */
+				continue;
+			}
+#endif
+			/* Otherwise, this is an error when accessing the socket. */
+			log_socket_error("jtag_vpi recv");
+			exit(-1);
+		} else if (retval == 0) {
+			/* Connection closed by the other side */
+			LOG_ERROR("Connection prematurely closed by jtag_vpi server.");
+			exit(-1);
+		}
+		/* Otherwise, we have successfully received some data */
+		bytes_buffered += retval;
+	}
+
+	return ERROR_OK;
+}
+
+static int jtag_vpi_send_cmd(struct vpi_cmd *vpi)
+{
 	/* Optional low-level JTAG debug */
 	if (LOG_LEVEL_IS(LOG_LVL_DEBUG_IO)) {
 		if (vpi->nb_bits > 0) {
@@ -125,76 +230,149 @@ static int jtag_vpi_send_cmd(struct vpi_cmd *vpi)
 	h_u32_to_le(vpi->length_buf, vpi->length);
 	h_u32_to_le(vpi->nb_bits_buf, vpi->nb_bits);
 
-retry_write:
-	retval = write_socket(sockfd, vpi, sizeof(struct vpi_cmd));
+	return jtag_vpi_write(vpi, sizeof(struct vpi_cmd));
+}
 
-	if (retval < 0) {
-		/* Account for the case when socket write is interrupted. */
-#ifdef _WIN32
-		int wsa_err = WSAGetLastError();
-		if (wsa_err == WSAEINTR)
-			goto retry_write;
-#else
-		if (errno == EINTR)
-			goto retry_write;
-#endif
-		/* Otherwise this is an error using the socket, most likely fatal
-		   for the connection. B*/
-		log_socket_error("jtag_vpi xmit");
-		/* TODO: Clean way how adapter drivers can report fatal errors
-		   to upper layers of OpenOCD and let it perform an orderly shutdown? */
-		exit(-1);
-	} else if (retval < (int)sizeof(struct vpi_cmd)) {
-		/* This means we could not send all data, which is most likely fatal
-		   for the jtag_vpi connection (the underlying TCP connection likely not
-		   usable anymore) */
-		LOG_ERROR("jtag_vpi: Could not send all data through jtag_vpi connection.");
-		exit(-1);
+static int jtag_vpi_receive_cmd(struct vpi_cmd *vpi)
+{
+	int retval = jtag_vpi_read(vpi, sizeof(struct vpi_cmd));
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* Use little endian when transmitting/receiving jtag_vpi cmds. */
+	vpi->cmd = le_to_h_u32(vpi->cmd_buf);
+	vpi->length = le_to_h_u32(vpi->length_buf);
+	vpi->nb_bits = le_to_h_u32(vpi->nb_bits_buf);
+
+	return ERROR_OK;
+}
+
+static int jtag_vpi_bulk_reserve(size_t len)
+{
+	if (bulk.used + len <= bulk.size)
+		return ERROR_OK;
+
+	size_t size = MAX(bulk.size * 2, bulk.used + len);
+	uint8_t *data = realloc(bulk.data, size);
+	if (!data) {
+		LOG_ERROR("jtag_vpi: out of memory");
+		return ERROR_FAIL;
 	}
 
-	/* Otherwise the packet has been sent successfully. */
+	bulk.data = data;
+	bulk.size = size;
 	return ERROR_OK;
 }
 
-static int jtag_vpi_receive_cmd(struct vpi_cmd *vpi)
+/**
+ * jtag_vpi_bulk_append - add one record to the next bulk frame
+ * @param op CMD_RESET, CMD_TMS_SEQ, CMD_SCAN_CHAIN or CMD_SCAN_CHAIN_FLIP_TMS
+ * @param bits TMS or TDI bits (or NULL to shift out ones)
+ * @param nb_bits number of bits
+ * @param flags BULK_CAPTURE if the TDO data is to be returned
+ */
+static int jtag_vpi_bulk_append(uint8_t op, const uint8_t *bits, uint32_t nb_bits,
+		uint8_t flags)
 {
-	unsigned int bytes_buffered = 0;
-	while (bytes_buffered < sizeof(struct vpi_cmd)) {
-		int bytes_to_receive = sizeof(struct vpi_cmd) - bytes_buffered;
-		int retval = read_socket(sockfd, ((char *)vpi) + bytes_buffered, bytes_to_receive);
-		if (retval < 0) {
-#ifdef _WIN32
-			int wsa_err = WSAGetLastError();
-			if (wsa_err == WSAEINTR) {
-				/* socket read interrupted by WSACancelBlockingCall() */
-				continue;
-			}
-#else
-			if (errno == EINTR) {
-				/* socket read interrupted by a signal */
-				continue;
-			}
-#endif
-			/* Otherwise, this is an error when accessing the socket. */
-			log_socket_error("jtag_vpi recv");
-			exit(-1);
-		} else if (retval == 0) {
-			/* Connection closed by the other side */
-			LOG_ERROR("Connection prematurely closed by jtag_vpi server.");
-			exit(-1);
+	unsigned int nb_bytes = DIV_ROUND_UP(nb_bits, 8);
+
+	int retval = jtag_vpi_bulk_reserve(BULK_RECORD_HEADER + nb_bytes);
+	if (retval != ERROR_OK)
+		return retval;
+
+	LOG_DEBUG_IO("queueing JTAG VPI bulk record: cmd=%s, nb_bits=%" PRIu32 ", flags=0x%x",
+			jtag_vpi_cmd_to_str(op), nb_bits, flags);
+
+	uint8_t *record = bulk.data + bulk.used;
+	record[0] = op;
+	record[1] = flags;
+	h_u32_to_le(record + 2, nb_bits);
+	if (bits)
+		memcpy(record + BULK_RECORD_HEADER, bits, nb_bytes);
+	else
+		memset(record + BULK_RECORD_HEADER, 0xff, nb_bytes);
+
+	bulk.used += BULK_RECORD_HEADER + nb_bytes;
+	return ERROR_OK;
+}
+
+/**
+ * jtag_vpi_bulk_capture - complete a scan once the bulk frame is sent
+ * @param cmd the scan command
+ * @param buf scan buffer, owned by the bulk frame from now on
+ * @param nb_bytes number of TDO bytes returned for the scan
+ */
+static int jtag_vpi_bulk_capture(struct scan_command *cmd, uint8_t *buf,
+		unsigned int nb_bytes)
+{
+	if (bulk.num_captures == bulk.max_captures) {
+		unsigned int max_captures = MAX(bulk.max_captures * 2, 16);
+		struct jtag_vpi_capture *captures = realloc(bulk.captures,
+				max_captures * sizeof(*captures));
+		if (!captures) {
+			LOG_ERROR("jtag_vpi: out of memory");
+			free(buf);
+			return ERROR_FAIL;
 		}
-		/* Otherwise, we have successfully received some data */
-		bytes_buffered += retval;
+		bulk.captures = captures;
+		bulk.max_captures = max_captures;
 	}
 
-	/* Use little endian when transmitting/receiving jtag_vpi cmds. */
-	vpi->cmd = le_to_h_u32(vpi->cmd_buf);
-	vpi->length = le_to_h_u32(vpi->length_buf);
-	vpi->nb_bits = le_to_h_u32(vpi->nb_bits_buf);
+	bulk.captures[bulk.num_captures].cmd = cmd;
+	bulk.captures[bulk.num_captures].buf = buf;
+	bulk.captures[bulk.num_captures].nb_bytes = nb_bytes;
+	bulk.num_captures++;
 
 	return ERROR_OK;
 }
 
+static void jtag_vpi_bulk_discard(void)
+{
+	for (unsigned int i = 0; i < bulk.num_captures; i++)
+		free(bulk.captures[i].buf);
+
+	bulk.num_captures = 0;
+	bulk.used = 0;
+}
+
+/**
+ * jtag_vpi_bulk_flush - send the collected bulk frame
+ *
+ * The frame is sent as CMD_BULK and its length, both 32-bit little endian,
+ * followed by the records. The server answers with the TDO data of the
+ * records flagged BULK_CAPTURE, concatenated in order.
+ */
+static int jtag_vpi_bulk_flush(void)
+{
+	uint8_t header[8];
+	int retval = ERROR_OK;
+
+	if (!bulk.used)
+		return ERROR_OK;
+
+	LOG_DEBUG_IO("sending JTAG VPI bulk frame: length=%zu, captures=%u",
+			bulk.used, bulk.num_captures);
+
+	h_u32_to_le(header, CMD_BULK);
+	h_u32_to_le(header + 4, bulk.used);
+
+	retval = jtag_vpi_write(header, sizeof(header));
+	if (retval == ERROR_OK)
+		retval = jtag_vpi_write(bulk.data, bulk.used);
+
+	for (unsigned int i = 0; retval == ERROR_OK && i < bulk.num_captures; i++) {
+		struct jtag_vpi_capture *capture = &bulk.captures[i];
+
+		retval = jtag_vpi_read(capture->buf, capture->nb_bytes);
+		if (retval == ERROR_OK)
+			retval = jtag_read_buffer(capture->buf, capture->cmd);
+	}
+
+	jtag_vpi_bulk_discard();
+
+	return retval;
+}
+
 /**
  * jtag_vpi_reset - ask to reset the JTAG device
  * @param trst 1 if TRST is to be asserted
@@ -203,6 +381,10 @@ static int jtag_vpi_receive_cmd(struct vpi_cmd *vpi)
 static int jtag_vpi_reset(int trst, int srst)
 {
 	struct vpi_cmd vpi;
+
+	if (server_version >= JTAG_VPI_VERSION_BULK)
+		return jtag_vpi_bulk_append(CMD_RESET, NULL, 0, 0);
+
 	memset(&vpi, 0, sizeof(struct vpi_cmd));
 
 	vpi.cmd = CMD_RESET;
@@ -226,6 +408,9 @@ static int jtag_vpi_tms_seq(const uint8_t *bits, int nb_bits)
 	struct vpi_cmd vpi;
 	int nb_bytes;
 
+	if (server_version >= JTAG_VPI_VERSION_BULK)
+		return jtag_vpi_bulk_append(CMD_TMS_SEQ, bits, nb_bits, 0);
+
 	memset(&vpi, 0, sizeof(struct vpi_cmd));
 	nb_bytes = DIV_ROUND_UP(nb_bits, 8);
 
@@ -340,6 +525,11 @@ static int jtag_vpi_queue_tdi(uint8_t *bits, int nb_bits, int tap_shift)
 	int nb_xfer = DIV_ROUND_UP(nb_bits, XFERT_MAX_SIZE * 8);
 	int retval;
 
+	/* A bulk record is not limited to XFERT_MAX_SIZE */
+	if (server_version >= JTAG_VPI_VERSION_BULK)
+		return jtag_vpi_bulk_append(tap_shift ? CMD_SCAN_CHAIN_FLIP_TMS : CMD_SCAN_CHAIN,
+				bits, nb_bits, bits ? BULK_CAPTURE : 0);
+
 	while (nb_xfer) {
 		if (nb_xfer ==  1) {
 			retval = jtag_vpi_queue_tdi_xfer(bits, nb_bits, tap_shift);
@@ -425,11 +615,18 @@ static int jtag_vpi_scan(struct scan_command *cmd)
 			tap_set_state(TAP_DRPAUSE);
 	}
 
-	retval = jtag_read_buffer(buf, cmd);
-	if (retval != ERROR_OK)
-		return retval;
+	if (server_version >= JTAG_VPI_VERSION_BULK) {
+		/* completed by jtag_vpi_bulk_flush() */
+		retval = jtag_vpi_bulk_capture(cmd, buf, DIV_ROUND_UP(scan_bits, 8));
+		if (retval != ERROR_OK)
+			return retval;
+	} else {
+		retval = jtag_read_buffer(buf, cmd);
+		if (retval != ERROR_OK)
+			return retval;
 
-	free(buf);
+		free(buf);
+	}
 
 	if (cmd->end_state != TAP_DRSHIFT) {
 		retval = jtag_vpi_state_move(cmd->end_state);
@@ -506,6 +703,7 @@ static int jtag_vpi_execute_queue(struct jtag_command *cmd_queue)
 			retval = jtag_vpi_tms(cmd->cmd.tms);
 			break;
 		case JTAG_SLEEP:
+			retval = jtag_vpi_bulk_flush();
 			jtag_sleep(cmd->cmd.sleep->us);
 			break;
 		case JTAG_SCAN:
@@ -517,11 +715,50 @@ static int jtag_vpi_execute_queue(struct jtag_command *cmd_queue)
 			retval = ERROR_FAIL;
 			break;
 		}
+
+		if (retval == ERROR_OK && bulk.used >= BULK_FRAME_MAX)
+			retval = jtag_vpi_bulk_flush();
 	}
 
+	if (retval == ERROR_OK)
+		retval = jtag_vpi_bulk_flush();
+	else
+		jtag_vpi_bulk_discard();
+
 	return retval;
 }
 
+/**
+ * jtag_vpi_get_version - negotiate the protocol version with the server
+ *
+ * The probe is a scan of zero bits carrying JTAG_VPI_VERSION_MAGIC, which
+ * older servers answer without touching the TAP. Newer servers reply with
+ * the magic and their protocol version in buffer_in.
+ */
+static int jtag_vpi_get_version(void)
+{
+	struct vpi_cmd vpi;
+
+	memset(&vpi, 0, sizeof(struct vpi_cmd));
+	vpi.cmd = CMD_SCAN_CHAIN;
+	memcpy(vpi.buffer_out, JTAG_VPI_VERSION_MAGIC, 4);
+
+	int retval = jtag_vpi_send_cmd(&vpi);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = jtag_vpi_receive_cmd(&vpi);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (memcmp(vpi.buffer_in, JTAG_VPI_VERSION_MAGIC, 4) == 0)
+		server_version = le_to_h_u32(vpi.buffer_in + 4);
+	else
+		server_version = JTAG_VPI_VERSION_LEGACY;
+
+	return ERROR_OK;
+}
+
 static int jtag_vpi_init(void)
 {
 	int flag = 1;
@@ -562,6 +799,15 @@ static int jtag_vpi_init(void)
 
 	LOG_INFO("jtag_vpi: Connection to %s : %u successful", server_address, server_port);
 
+	int retval = jtag_vpi_get_version();
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (server_version >= JTAG_VPI_VERSION_BULK)
+		LOG_INFO("jtag_vpi: server protocol version %u, using bulk frames", server_version);
+	else
+		LOG_INFO("jtag_vpi: legacy server, sending one command at a time");
+
 	return ERROR_OK;
 }
 
@@ -586,6 +832,8 @@ static int jtag_vpi_quit(void)
 		log_socket_error("jtag_vpi");
 	}
 	free(server_address);
+	free(bulk.data);
+	free(bulk.captures);
 	return ERROR_OK;
 }
 
@@ -10,6 +10,7 @@
 #endif
 
 #include "mpsse.h"
+#include "helper/io_trace.h"
 #include "helper/log.h"
 #include "helper/replacements.h"
 #include "helper/time_support.h"
@@ -52,6 +53,22 @@
 #define SIO_RESET_PURGE_RX 1
 #define SIO_RESET_PURGE_TX 2
 
+/* Number of flushes that may be in flight at the same time */
+#define MPSSE_RING_SIZE 4
+
+/* Buffers and USB transfer of one flush */
+struct mpsse_slot {
+	struct libusb_transfer *write_transfer;
+	uint8_t *write_buffer;
+	unsigned int write_count;
+	unsigned int write_transferred;
+	bool write_done;
+	uint8_t *read_buffer;
+	unsigned int read_count;
+	unsigned int read_transferred;
+	struct bit_copy_queue read_queue;
+};
+
 struct mpsse_ctx {
 	struct libusb_context *usb_ctx;
 	struct libusb_device_handle *usb_dev;
@@ -73,9 +90,19 @@ struct mpsse_ctx {
 	unsigned int read_chunk_size;
 	struct bit_copy_queue read_queue;
 	int retval;
+
+	/* Flushes in flight, oldest first */
+	struct mpsse_slot ring[MPSSE_RING_SIZE];
+	unsigned int ring_first;
+	unsigned int ring_count;
+	/* A single read transfer collects the data of all flushes in flight */
+	struct libusb_transfer *read_transfer;
+	bool read_submitted;
 };
 
 static void mpsse_purge(struct mpsse_ctx *ctx);
+static int ring_submit(struct mpsse_ctx *ctx);
+static int ring_abort(struct mpsse_ctx *ctx);
 
 /* Returns true if the string descriptor indexed by str_index in device matches string */
 static bool string_descriptor_equal(struct libusb_device_handle *device, uint8_t str_index,
@@ -339,6 +366,8 @@ struct mpsse_ctx *mpsse_open(const uint16_t vids[], const uint16_t pids[], const
 		return NULL;
 
 	bit_copy_queue_init(&ctx->read_queue);
+	for (unsigned int i = 0; i < MPSSE_RING_SIZE; i++)
+		bit_copy_queue_init(&ctx->ring[i].read_queue);
 	ctx->read_chunk_size = 16384;
 	ctx->read_size = 16384;
 	ctx->write_size = 16384;
@@ -354,6 +383,21 @@ struct mpsse_ctx *mpsse_open(const uint16_t vids[], const uint16_t pids[], const
 	if (!ctx->read_chunk || !ctx->read_buffer || !ctx->write_buffer)
 		goto error;
 
+	/* Transfers and buffers are reused by all flushes */
+	ctx->read_transfer = libusb_alloc_transfer(0);
+	if (!ctx->read_transfer)
+		goto error;
+
+	for (unsigned int i = 0; i < MPSSE_RING_SIZE; i++) {
+		struct mpsse_slot *slot = &ctx->ring[i];
+
+		slot->write_transfer = libusb_alloc_transfer(0);
+		slot->write_buffer = calloc(1, ctx->write_size);
+		slot->read_buffer = malloc(ctx->read_size);
+		if (!slot->write_transfer || !slot->write_buffer || !slot->read_buffer)
+			goto error;
+	}
+
 	ctx->interface = channel;
 	ctx->index = channel + 1;
 	ctx->usb_read_timeout = 5000;
@@ -406,12 +450,22 @@ error:
 
 void mpsse_close(struct mpsse_ctx *ctx)
 {
+	if (ctx->ring_count)
+		ring_abort(ctx);
 	if (ctx->usb_dev)
 		libusb_close(ctx->usb_dev);
 	if (ctx->usb_ctx)
 		libusb_exit(ctx->usb_ctx);
 	bit_copy_discard(&ctx->read_queue);
 
+	for (unsigned int i = 0; i < MPSSE_RING_SIZE; i++) {
+		bit_copy_discard(&ctx->ring[i].read_queue);
+		libusb_free_transfer(ctx->ring[i].write_transfer);
+		free(ctx->ring[i].write_buffer);
+		free(ctx->ring[i].read_buffer);
+	}
+	libusb_free_transfer(ctx->read_transfer);
+
 	free(ctx->write_buffer);
 	free(ctx->read_buffer);
 	free(ctx->read_chunk);
@@ -518,7 +572,7 @@ void mpsse_clock_data(struct mpsse_ctx *ctx, const uint8_t *out, unsigned int ou
 		/* Guarantee buffer space enough for a minimum size transfer */
 		if (buffer_write_space(ctx) + (length < 8) < (out || (!out && !in) ? 4 : 3)
 				|| (in && buffer_read_space(ctx) < 1))
-			ctx->retval = mpsse_flush(ctx);
+			ctx->retval = ring_submit(ctx);
 
 		if (length < 8) {
 			/* Transfer remaining bits in bit mode */
@@ -592,7 +646,7 @@ void mpsse_clock_tms_cs(struct mpsse_ctx *ctx, const uint8_t *out, unsigned int
 	while (length > 0) {
 		/* Guarantee buffer space enough for a minimum size transfer */
 		if (buffer_write_space(ctx) < 3 || (in && buffer_read_space(ctx) < 1))
-			ctx->retval = mpsse_flush(ctx);
+			ctx->retval = ring_submit(ctx);
 
 		/* Byte transfer */
 		unsigned int this_bits = length;
@@ -635,7 +689,7 @@ void mpsse_set_data_bits_low_byte(struct mpsse_ctx *ctx, uint8_t data, uint8_t d
 	}
 
 	if (buffer_write_space(ctx) < 3)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = ring_submit(ctx);
 
 	buffer_write_byte(ctx, 0x80);
 	buffer_write_byte(ctx, data);
@@ -652,7 +706,7 @@ void mpsse_set_data_bits_high_byte(struct mpsse_ctx *ctx, uint8_t data, uint8_t
 	}
 
 	if (buffer_write_space(ctx) < 3)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = ring_submit(ctx);
 
 	buffer_write_byte(ctx, 0x82);
 	buffer_write_byte(ctx, data);
@@ -669,7 +723,7 @@ void mpsse_read_data_bits_low_byte(struct mpsse_ctx *ctx, uint8_t *data)
 	}
 
 	if (buffer_write_space(ctx) < 1 || buffer_read_space(ctx) < 1)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = ring_submit(ctx);
 
 	buffer_write_byte(ctx, 0x81);
 	buffer_add_read(ctx, data, 0, 8, 0);
@@ -685,7 +739,7 @@ void mpsse_read_data_bits_high_byte(struct mpsse_ctx *ctx, uint8_t *data)
 	}
 
 	if (buffer_write_space(ctx) < 1 || buffer_read_space(ctx) < 1)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = ring_submit(ctx);
 
 	buffer_write_byte(ctx, 0x83);
 	buffer_add_read(ctx, data, 0, 8, 0);
@@ -700,7 +754,7 @@ static void single_byte_boolean_helper(struct mpsse_ctx *ctx, bool var, uint8_t
 	}
 
 	if (buffer_write_space(ctx) < 1)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = ring_submit(ctx);
 
 	buffer_write_byte(ctx, var ? val_if_true : val_if_false);
 }
@@ -721,7 +775,7 @@ static void mpsse_set_divisor(struct mpsse_ctx *ctx, uint16_t divisor)
 	}
 
 	if (buffer_write_space(ctx) < 3)
-		ctx->retval = mpsse_flush(ctx);
+		ctx->retval = ring_submit(ctx);
 
 	buffer_write_byte(ctx, 0x86);
 	buffer_write_byte(ctx, divisor & 0xff);
@@ -781,121 +835,156 @@ int mpsse_set_frequency(struct mpsse_ctx *ctx, int frequency)
 	return frequency;
 }
 
-/* Context needed by the callbacks */
-struct transfer_result {
-	struct mpsse_ctx *ctx;
-	bool done;
-	unsigned int transferred;
-};
+/* Returns the oldest flush in flight still waiting for read data */
+static struct mpsse_slot *ring_read_slot(struct mpsse_ctx *ctx)
+{
+	for (unsigned int i = 0; i < ctx->ring_count; i++) {
+		struct mpsse_slot *slot = &ctx->ring[(ctx->ring_first + i) % MPSSE_RING_SIZE];
+		if (slot->read_transferred < slot->read_count)
+			return slot;
+	}
+
+	return NULL;
+}
 
 static LIBUSB_CALL void read_cb(struct libusb_transfer *transfer)
 {
-	struct transfer_result *res = transfer->user_data;
-	struct mpsse_ctx *ctx = res->ctx;
-
+	struct mpsse_ctx *ctx = transfer->user_data;
 	unsigned int packet_size = ctx->max_packet_size;
 
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED
+			&& transfer->status != LIBUSB_TRANSFER_TIMED_OUT) {
+		LOG_DEBUG_IO("read transfer ended with status %d", transfer->status);
+		ctx->read_submitted = false;
+		return;
+	}
+
 	DEBUG_PRINT_BUF(transfer->buffer, transfer->actual_length);
 
 	/* Strip the two status bytes sent at the beginning of each USB packet
-	 * while copying the chunk buffer to the read buffer */
+	 * while copying the chunk buffer to the read buffers. The data of one
+	 * chunk may belong to several flushes, hand it out in order. */
 	unsigned int num_packets = DIV_ROUND_UP(transfer->actual_length, packet_size);
 	unsigned int chunk_remains = transfer->actual_length;
+	struct mpsse_slot *slot = ring_read_slot(ctx);
 	for (unsigned int i = 0; i < num_packets && chunk_remains > 2; i++) {
-		unsigned int this_size = packet_size - 2;
-		if (this_size > chunk_remains - 2)
-			this_size = chunk_remains - 2;
-		if (this_size > ctx->read_count - res->transferred)
-			this_size = ctx->read_count - res->transferred;
-		memcpy(ctx->read_buffer + res->transferred,
-			ctx->read_chunk + packet_size * i + 2,
-			this_size);
-		res->transferred += this_size;
-		chunk_remains -= this_size + 2;
-		if (res->transferred == ctx->read_count) {
-			res->done = true;
-			break;
+		const uint8_t *data = ctx->read_chunk + packet_size * i + 2;
+		unsigned int data_size = packet_size - 2;
+		if (data_size > chunk_remains - 2)
+			data_size = chunk_remains - 2;
+		chunk_remains -= data_size + 2;
+
+		while (data_size > 0 && slot) {
+			unsigned int this_size = slot->read_count - slot->read_transferred;
+			if (this_size > data_size)
+				this_size = data_size;
+			memcpy(slot->read_buffer + slot->read_transferred, data, this_size);
+			slot->read_transferred += this_size;
+			data += this_size;
+			data_size -= this_size;
+			if (slot->read_transferred == slot->read_count)
+				slot = ring_read_slot(ctx);
 		}
 	}
 
-	LOG_DEBUG_IO("raw chunk %d, transferred %d of %d", transfer->actual_length, res->transferred,
-		ctx->read_count);
+	LOG_DEBUG_IO("raw chunk %d", transfer->actual_length);
 
-	if (!res->done)
-		if (libusb_submit_transfer(transfer) != LIBUSB_SUCCESS)
-			res->done = true;
+	/* Keep reading as long as a flush in flight still expects data */
+	ctx->read_submitted = slot && libusb_submit_transfer(transfer) == LIBUSB_SUCCESS;
 }
 
 static LIBUSB_CALL void write_cb(struct libusb_transfer *transfer)
 {
-	struct transfer_result *res = transfer->user_data;
-	struct mpsse_ctx *ctx = res->ctx;
+	struct mpsse_slot *slot = transfer->user_data;
 
-	res->transferred += transfer->actual_length;
+	slot->write_transferred += transfer->actual_length;
 
-	LOG_DEBUG_IO("transferred %d of %d", res->transferred, ctx->write_count);
+	LOG_DEBUG_IO("transferred %d of %d", slot->write_transferred, slot->write_count);
 
 	DEBUG_PRINT_BUF(transfer->buffer, transfer->actual_length);
 
-	if (res->transferred == ctx->write_count)
-		res->done = true;
+	if (slot->write_transferred == slot->write_count
+			|| (transfer->status != LIBUSB_TRANSFER_COMPLETED
+				&& transfer->status != LIBUSB_TRANSFER_TIMED_OUT))
+		slot->write_done = true;
 	else {
-		transfer->length = ctx->write_count - res->transferred;
-		transfer->buffer = ctx->write_buffer + res->transferred;
+		transfer->length = slot->write_count - slot->write_transferred;
+		transfer->buffer = slot->write_buffer + slot->write_transferred;
 		if (libusb_submit_transfer(transfer) != LIBUSB_SUCCESS)
-			res->done = true;
+			slot->write_done = true;
 	}
 }
 
-int mpsse_flush(struct mpsse_ctx *ctx)
+static void ring_trace(enum io_trace_type type, const struct mpsse_slot *slot,
+	int status)
 {
-	int retval = ctx->retval;
+	if (!io_trace_enabled())
+		return;
 
-	if (retval != ERROR_OK) {
-		LOG_DEBUG_IO("Ignoring flush due to previous error");
-		assert(ctx->write_count == 0 && ctx->read_count == 0);
-		ctx->retval = ERROR_OK;
-		return retval;
-	}
+	const struct io_trace_usb record = {
+		.write_count = slot->write_count,
+		.read_count = slot->read_count,
+		.write_transferred = slot->write_transferred,
+		.read_transferred = slot->read_transferred,
+		.status = status,
+	};
+	io_trace_record(type, &record, sizeof(record));
+}
 
-	LOG_DEBUG_IO("write %d%s, read %d", ctx->write_count, ctx->read_count ? "+1" : "",
-			ctx->read_count);
-	assert(ctx->write_count > 0 || ctx->read_count == 0); /* No read data without write data */
+static bool ring_slot_done(struct mpsse_slot *slot)
+{
+	return slot->write_done && slot->read_transferred == slot->read_count;
+}
 
-	if (ctx->write_count == 0)
-		return retval;
+/* Cancel all transfers in flight, drop their results and purge the chip */
+static int ring_abort(struct mpsse_ctx *ctx)
+{
+	for (unsigned int i = 0; i < ctx->ring_count; i++) {
+		struct mpsse_slot *slot = &ctx->ring[(ctx->ring_first + i) % MPSSE_RING_SIZE];
+		if (!slot->write_done)
+			libusb_cancel_transfer(slot->write_transfer);
+	}
+	if (ctx->read_submitted)
+		libusb_cancel_transfer(ctx->read_transfer);
+
+	for (;;) {
+		bool busy = ctx->read_submitted;
+		for (unsigned int i = 0; i < ctx->ring_count; i++)
+			busy |= !ctx->ring[(ctx->ring_first + i) % MPSSE_RING_SIZE].write_done;
+		if (!busy)
+			break;
 
-	struct libusb_transfer *read_transfer = NULL;
-	struct transfer_result read_result = { .ctx = ctx, .done = true };
-	if (ctx->read_count) {
-		buffer_write_byte(ctx, 0x87); /* SEND_IMMEDIATE */
-		read_result.done = false;
-		/* delay read transaction to ensure the FTDI chip can support us with data
-		   immediately after processing the MPSSE commands in the write transaction */
-	}
-
-	struct transfer_result write_result = { .ctx = ctx, .done = false };
-	struct libusb_transfer *write_transfer = libusb_alloc_transfer(0);
-	libusb_fill_bulk_transfer(write_transfer, ctx->usb_dev, ctx->out_ep, ctx->write_buffer,
-		ctx->write_count, write_cb, &write_result, ctx->usb_write_timeout);
-	retval = libusb_submit_transfer(write_transfer);
-	if (retval != LIBUSB_SUCCESS)
-		goto error_check;
-
-	if (ctx->read_count) {
-		read_transfer = libusb_alloc_transfer(0);
-		libusb_fill_bulk_transfer(read_transfer, ctx->usb_dev, ctx->in_ep, ctx->read_chunk,
-			ctx->read_chunk_size, read_cb, &read_result,
-			ctx->usb_read_timeout);
-		retval = libusb_submit_transfer(read_transfer);
-		if (retval != LIBUSB_SUCCESS)
-			goto error_check;
+		struct timeval timeout_usb = {
+			.tv_sec = 1,
+			.tv_usec = 0
+		};
+		int retval = libusb_handle_events_timeout_completed(ctx->usb_ctx, &timeout_usb, NULL);
+		if (retval != LIBUSB_SUCCESS && retval != LIBUSB_ERROR_INTERRUPTED) {
+			LOG_ERROR("unable to cancel ftdi transfers: %s", libusb_error_name(retval));
+			break;
+		}
 	}
 
+	for (unsigned int i = 0; i < MPSSE_RING_SIZE; i++)
+		bit_copy_discard(&ctx->ring[i].read_queue);
+	ctx->ring_first = 0;
+	ctx->ring_count = 0;
+
+	mpsse_purge(ctx);
+
+	return ERROR_FAIL;
+}
+
+/* Wait for the oldest flush in flight and deliver its read data */
+static int ring_complete(struct mpsse_ctx *ctx)
+{
+	struct mpsse_slot *slot = &ctx->ring[ctx->ring_first];
+	int retval = LIBUSB_SUCCESS;
+
 	/* Polling loop, more or less taken from libftdi */
 	int64_t start = timeval_ms();
 	int64_t warn_after = 2000;
-	while (!write_result.done || !read_result.done) {
+	while (!ring_slot_done(slot)) {
 		struct timeval timeout_usb;
 
 		timeout_usb.tv_sec = 1;
@@ -914,44 +1003,124 @@ int mpsse_flush(struct mpsse_ctx *ctx)
 		if (retval == LIBUSB_ERROR_INTERRUPTED)
 			continue;
 
-		if (retval != LIBUSB_SUCCESS) {
-			libusb_cancel_transfer(write_transfer);
-			if (read_transfer)
-				libusb_cancel_transfer(read_transfer);
-		}
+		if (retval != LIBUSB_SUCCESS)
+			break;
+
+		/* The read transfer has failed, the missing data will never come */
+		if (slot->write_done && !ctx->read_submitted)
+			break;
 	}
 
-error_check:
-	if (retval != LIBUSB_SUCCESS) {
+	ring_trace(IO_TRACE_MPSSE_COMPLETE, slot, retval);
+
+	if (retval != LIBUSB_SUCCESS && retval != LIBUSB_ERROR_INTERRUPTED) {
 		LOG_ERROR("libusb_handle_events() failed with %s", libusb_error_name(retval));
-		retval = ERROR_FAIL;
-	} else if (write_result.transferred < ctx->write_count) {
+		return ring_abort(ctx);
+	} else if (slot->write_transferred < slot->write_count) {
 		LOG_ERROR("ftdi device did not accept all data: %d, tried %d",
-			write_result.transferred,
-			ctx->write_count);
-		retval = ERROR_FAIL;
-	} else if (read_result.transferred < ctx->read_count) {
+			slot->write_transferred,
+			slot->write_count);
+		return ring_abort(ctx);
+	} else if (slot->read_transferred < slot->read_count) {
 		LOG_ERROR("ftdi device did not return all data: %d, expected %d",
-			read_result.transferred,
-			ctx->read_count);
-		retval = ERROR_FAIL;
-	} else if (ctx->read_count) {
-		ctx->write_count = 0;
-		ctx->read_count = 0;
-		bit_copy_execute(&ctx->read_queue);
-		retval = ERROR_OK;
-	} else {
-		ctx->write_count = 0;
-		bit_copy_discard(&ctx->read_queue);
-		retval = ERROR_OK;
+			slot->read_transferred,
+			slot->read_count);
+		return ring_abort(ctx);
+	}
+
+	bit_copy_execute(&slot->read_queue);
+	ctx->ring_first = (ctx->ring_first + 1) % MPSSE_RING_SIZE;
+	ctx->ring_count--;
+
+	return ERROR_OK;
+}
+
+/* Hand the queued commands over to USB without waiting for them. The
+ * buffers are swapped with a free slot of the ring, so queuing can go on
+ * while the transfers are in flight. */
+static int ring_submit(struct mpsse_ctx *ctx)
+{
+	int retval;
+
+	if (ctx->write_count == 0)
+		return ERROR_OK;
+
+	if (ctx->ring_count == MPSSE_RING_SIZE) {
+		retval = ring_complete(ctx);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	if (ctx->read_count)
+		buffer_write_byte(ctx, 0x87); /* SEND_IMMEDIATE */
+
+	struct mpsse_slot *slot = &ctx->ring[(ctx->ring_first + ctx->ring_count) % MPSSE_RING_SIZE];
+
+	uint8_t *buffer = slot->write_buffer;
+	slot->write_buffer = ctx->write_buffer;
+	ctx->write_buffer = buffer;
+	buffer = slot->read_buffer;
+	slot->read_buffer = ctx->read_buffer;
+	ctx->read_buffer = buffer;
+	list_splice_tail_init(&ctx->read_queue.list, &slot->read_queue.list);
+
+	slot->write_count = ctx->write_count;
+	slot->write_transferred = 0;
+	slot->write_done = false;
+	slot->read_count = ctx->read_count;
+	slot->read_transferred = 0;
+	ctx->write_count = 0;
+	ctx->read_count = 0;
+	ctx->ring_count++;
+
+	ring_trace(IO_TRACE_MPSSE_SUBMIT, slot, 0);
+
+	libusb_fill_bulk_transfer(slot->write_transfer, ctx->usb_dev, ctx->out_ep, slot->write_buffer,
+		slot->write_count, write_cb, slot, ctx->usb_write_timeout);
+	retval = libusb_submit_transfer(slot->write_transfer);
+	if (retval != LIBUSB_SUCCESS) {
+		slot->write_done = true;
+		LOG_ERROR("libusb_submit_transfer() failed with %s", libusb_error_name(retval));
+		return ring_abort(ctx);
 	}
 
-	if (retval != ERROR_OK)
-		mpsse_purge(ctx);
+	/* Submit the read after the write to ensure the FTDI chip can support
+	 * us with data immediately after processing the MPSSE commands. One
+	 * read transfer serves all flushes in flight. */
+	if (slot->read_count && !ctx->read_submitted) {
+		libusb_fill_bulk_transfer(ctx->read_transfer, ctx->usb_dev, ctx->in_ep, ctx->read_chunk,
+			ctx->read_chunk_size, read_cb, ctx, ctx->usb_read_timeout);
+		retval = libusb_submit_transfer(ctx->read_transfer);
+		if (retval != LIBUSB_SUCCESS) {
+			LOG_ERROR("libusb_submit_transfer() failed with %s", libusb_error_name(retval));
+			return ring_abort(ctx);
+		}
+		ctx->read_submitted = true;
+	}
+
+	return ERROR_OK;
+}
+
+int mpsse_flush(struct mpsse_ctx *ctx)
+{
+	int retval = ctx->retval;
+
+	if (retval != ERROR_OK) {
+		LOG_DEBUG_IO("Ignoring flush due to previous error");
+		assert(ctx->write_count == 0 && ctx->read_count == 0);
+		assert(ctx->ring_count == 0);
+		ctx->retval = ERROR_OK;
+		return retval;
+	}
+
+	LOG_DEBUG_IO("write %d%s, read %d, %u in flight", ctx->write_count,
+			ctx->read_count ? "+1" : "", ctx->read_count, ctx->ring_count);
+	assert(ctx->write_count > 0 || ctx->read_count == 0); /* No read data without write data */
+
+	retval = ring_submit(ctx);
 
-	libusb_free_transfer(write_transfer);
-	if (read_transfer)
-		libusb_free_transfer(read_transfer);
+	while (retval == ERROR_OK && ctx->ring_count)
+		retval = ring_complete(ctx);
 
 	return retval;
 }
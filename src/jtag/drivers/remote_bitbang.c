@@ -24,6 +24,18 @@
 /* arbitrary limit on host name length: */
 #define REMOTE_BITBANG_HOST_MAX 255
 
+/* Lowest protocol version which supports block scans */
+#define REMOTE_BITBANG_VERSION_BLOCK_SCAN 2
+
+/* Flags of the block scan request */
+#define REMOTE_BITBANG_SCAN_CAPTURE 0x01
+#define REMOTE_BITBANG_SCAN_TMS_LAST 0x02
+
+/* Maximum number of bits shifted by one block scan request */
+#define REMOTE_BITBANG_SCAN_MAX_BITS 2048
+/* Maximum number of block scan requests waiting for their TDO data */
+#define REMOTE_BITBANG_SCAN_MAX_PENDING 8
+
 static char *remote_bitbang_host;
 static char *remote_bitbang_port;
 
@@ -33,6 +45,9 @@ static unsigned int remote_bitbang_send_buf_used;
 
 static bool use_remote_sleep;
 
+/* Protocol version reported by the remote host, 0 if it has no extensions */
+static unsigned int remote_bitbang_version;
+
 /* Circular buffer. When start == end, the buffer is empty. */
 static char remote_bitbang_recv_buf[256];
 static unsigned int remote_bitbang_recv_buf_start;
@@ -198,16 +213,26 @@ static int remote_bitbang_sample(void)
 	return remote_bitbang_queue('R', NO_FLUSH);
 }
 
-static enum bb_value remote_bitbang_read_sample(void)
+/* Get the next byte sent by the remote host, waiting for it if needed. */
+static int remote_bitbang_recv(uint8_t *c)
 {
 	if (remote_bitbang_recv_buf_empty()) {
 		if (remote_bitbang_fill_buf(BLOCK) != ERROR_OK)
-			return BB_ERROR;
+			return ERROR_FAIL;
 	}
 	assert(!remote_bitbang_recv_buf_empty());
-	int c = remote_bitbang_recv_buf[remote_bitbang_recv_buf_start];
+	*c = remote_bitbang_recv_buf[remote_bitbang_recv_buf_start];
 	remote_bitbang_recv_buf_start =
 		(remote_bitbang_recv_buf_start + 1) % sizeof(remote_bitbang_recv_buf);
+	return ERROR_OK;
+}
+
+static enum bb_value remote_bitbang_read_sample(void)
+{
+	uint8_t c;
+
+	if (remote_bitbang_recv(&c) != ERROR_OK)
+		return BB_ERROR;
 	return char_to_int(c);
 }
 
@@ -217,6 +242,72 @@ static int remote_bitbang_write(int tck, int tms, int tdi)
 	return remote_bitbang_queue(c, NO_FLUSH);
 }
 
+/* Store the TDO data of the oldest block scan request in flight. */
+static int remote_bitbang_block_scan_recv(uint8_t *in, unsigned int offset,
+		unsigned int bit_cnt)
+{
+	for (unsigned int i = 0; i < bit_cnt; i += 8) {
+		uint8_t c;
+
+		if (remote_bitbang_recv(&c) != ERROR_OK)
+			return ERROR_FAIL;
+		buf_set_u32(in, offset + i, MIN(8, bit_cnt - i), c);
+	}
+
+	return ERROR_OK;
+}
+
+static int remote_bitbang_block_scan(const uint8_t *out, uint8_t *in, unsigned int bit_cnt)
+{
+	unsigned int recv_offset = 0;
+	unsigned int pending = 0;
+
+	for (unsigned int offset = 0; offset < bit_cnt; offset += REMOTE_BITBANG_SCAN_MAX_BITS) {
+		unsigned int chunk = MIN(bit_cnt - offset, REMOTE_BITBANG_SCAN_MAX_BITS);
+		uint8_t flags = 0;
+
+		if (in)
+			flags |= REMOTE_BITBANG_SCAN_CAPTURE;
+		if (offset + chunk == bit_cnt)
+			flags |= REMOTE_BITBANG_SCAN_TMS_LAST;
+
+		/* Collect the oldest TDO data before the remote host has to buffer
+		 * too much of it. All but the last request are full size. */
+		if (pending == REMOTE_BITBANG_SCAN_MAX_PENDING) {
+			if (remote_bitbang_block_scan_recv(in, recv_offset,
+					REMOTE_BITBANG_SCAN_MAX_BITS) != ERROR_OK)
+				return ERROR_FAIL;
+			recv_offset += REMOTE_BITBANG_SCAN_MAX_BITS;
+			pending--;
+		}
+
+		if (remote_bitbang_queue('S', NO_FLUSH) != ERROR_OK ||
+				remote_bitbang_queue(flags, NO_FLUSH) != ERROR_OK ||
+				remote_bitbang_queue(chunk & 0xff, NO_FLUSH) != ERROR_OK ||
+				remote_bitbang_queue(chunk >> 8, NO_FLUSH) != ERROR_OK)
+			return ERROR_FAIL;
+
+		for (unsigned int i = 0; i < chunk; i += 8) {
+			uint8_t tdi = out ? buf_get_u32(out, offset + i, MIN(8, chunk - i)) : 0;
+			if (remote_bitbang_queue(tdi, NO_FLUSH) != ERROR_OK)
+				return ERROR_FAIL;
+		}
+
+		if (in)
+			pending++;
+	}
+
+	while (pending) {
+		unsigned int chunk = MIN(bit_cnt - recv_offset, REMOTE_BITBANG_SCAN_MAX_BITS);
+		if (remote_bitbang_block_scan_recv(in, recv_offset, chunk) != ERROR_OK)
+			return ERROR_FAIL;
+		recv_offset += chunk;
+		pending--;
+	}
+
+	return ERROR_OK;
+}
+
 static int remote_bitbang_reset(int trst, int srst)
 {
 	char c = 'r' + ((trst ? 0x2 : 0x0) | (srst ? 0x1 : 0x0));
@@ -291,6 +382,57 @@ static const struct bitbang_interface remote_bitbang_bitbang = {
 	.flush = &remote_bitbang_flush,
 };
 
+static const struct bitbang_interface remote_bitbang_bitbang_block_scan = {
+	.buf_size = sizeof(remote_bitbang_recv_buf) - 1,
+	.sample = &remote_bitbang_sample,
+	.read_sample = &remote_bitbang_read_sample,
+	.write = &remote_bitbang_write,
+	.block_scan = &remote_bitbang_block_scan,
+	.swdio_read = &remote_bitbang_swdio_read,
+	.swdio_drive = &remote_bitbang_swdio_drive,
+	.swd_write = &remote_bitbang_swd_write,
+	.blink = &remote_bitbang_blink,
+	.sleep = &remote_bitbang_sleep,
+	.flush = &remote_bitbang_flush,
+};
+
+/* Ask the remote host for its protocol version. Hosts without protocol
+ * extensions ignore the version request and only answer the read request
+ * with '0' or '1'. Newer hosts answer the version request first, with a
+ * digit of at least '2'. */
+static int remote_bitbang_get_version(void)
+{
+	uint8_t c;
+
+	remote_bitbang_version = 0;
+
+	if (remote_bitbang_queue('V', NO_FLUSH) != ERROR_OK ||
+			remote_bitbang_queue('R', FLUSH_SEND_BUF) != ERROR_OK)
+		return ERROR_FAIL;
+
+	if (remote_bitbang_recv(&c) != ERROR_OK)
+		return ERROR_FAIL;
+
+	if (c == '0' || c == '1') {
+		LOG_DEBUG("remote_bitbang: remote host has no protocol extensions");
+		return ERROR_OK;
+	}
+
+	if (c < '2' || c > '9') {
+		LOG_ERROR("remote_bitbang: invalid version response: %c(%i)", c, c);
+		return ERROR_FAIL;
+	}
+
+	/* Answer to the read request */
+	if (remote_bitbang_read_sample() == BB_ERROR)
+		return ERROR_FAIL;
+
+	remote_bitbang_version = c - '0';
+	LOG_INFO("remote_bitbang: remote host protocol version %u", remote_bitbang_version);
+
+	return ERROR_OK;
+}
+
 static int remote_bitbang_init_tcp(void)
 {
 	struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
@@ -386,6 +528,12 @@ static int remote_bitbang_init(void)
 
 	socket_nonblock(remote_bitbang_fd);
 
+	if (remote_bitbang_get_version() != ERROR_OK)
+		return ERROR_FAIL;
+
+	if (remote_bitbang_version >= REMOTE_BITBANG_VERSION_BLOCK_SCAN)
+		bitbang_interface = &remote_bitbang_bitbang_block_scan;
+
 	LOG_INFO("remote_bitbang driver initialized");
 	return ERROR_OK;
 }
@@ -21,6 +21,7 @@
 #include <transport/transport.h>
 #include <helper/util.h>
 #include <helper/configuration.h>
+#include <helper/io_trace.h>
 #include <flash/nor/core.h>
 #include <flash/nand/core.h>
 #include <pld/pld.h>
@@ -238,6 +239,7 @@ static int (* const command_registrants[])(struct command_context *cmd_ctx_value
 	server_register_commands,
 	gdb_register_commands,
 	log_register_commands,
+	io_trace_register_commands,
 	rtt_server_register_commands,
 	transport_register_commands,
 	adapter_register_commands,
@@ -373,6 +375,7 @@ int openocd_main(int argc, char *argv[])
 	rtt_exit();
 	free_config();
 
+	io_trace_exit();
 	log_exit();
 
 #if USE_GCOV
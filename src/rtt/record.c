@@ -0,0 +1,257 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <helper/log.h>
+
+#include "rtt.h"
+
+/**
+ * @file
+ *
+ * RTT recorder.
+ *
+ * A recorder is an RTT sink that writes an up-channel to a file. When the
+ * file exceeds a given size, it is rotated: "file" becomes "file.1", "file.1"
+ * becomes "file.2" and so on, keeping at most a given number of old files.
+ */
+
+struct rtt_recorder {
+	unsigned int channel;
+	char *filename;
+	FILE *file;
+	/** Number of bytes written to the current file. */
+	uint64_t size;
+	/** Rotate the file once it reaches this size, 0 disables rotation. */
+	uint64_t max_size;
+	/** Number of rotated files to keep. */
+	unsigned int max_files;
+
+	struct rtt_recorder *next;
+};
+
+static struct rtt_recorder *recorders;
+
+static int rotate_file(struct rtt_recorder *recorder)
+{
+	size_t length = strlen(recorder->filename) + 12;
+	char *from = malloc(length);
+	char *to = malloc(length);
+
+	if (!from || !to) {
+		free(from);
+		free(to);
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	fclose(recorder->file);
+	recorder->file = NULL;
+
+	for (unsigned int i = recorder->max_files; i > 0; i--) {
+		if (i == 1)
+			snprintf(from, length, "%s", recorder->filename);
+		else
+			snprintf(from, length, "%s.%u", recorder->filename, i - 1);
+
+		snprintf(to, length, "%s.%u", recorder->filename, i);
+		remove(to);
+		rename(from, to);
+	}
+
+	free(from);
+	free(to);
+
+	recorder->file = fopen(recorder->filename, "wb");
+
+	if (!recorder->file) {
+		LOG_ERROR("rtt: Failed to open '%s'", recorder->filename);
+		return ERROR_FAIL;
+	}
+
+	recorder->size = 0;
+
+	return ERROR_OK;
+}
+
+static int recorder_read(unsigned int channel, const uint8_t *buffer,
+		size_t *length, void *user_data)
+{
+	struct rtt_recorder *recorder = user_data;
+	size_t offset = 0;
+
+	while (offset < *length) {
+		size_t chunk = *length - offset;
+
+		if (!recorder->file) {
+			*length = offset;
+			return ERROR_FAIL;
+		}
+
+		if (recorder->max_size) {
+			if (recorder->size >= recorder->max_size) {
+				if (rotate_file(recorder) != ERROR_OK) {
+					*length = offset;
+					return ERROR_FAIL;
+				}
+			}
+
+			chunk = MIN(chunk, recorder->max_size - recorder->size);
+		}
+
+		if (fwrite(buffer + offset, 1, chunk, recorder->file) != chunk) {
+			LOG_ERROR("rtt: Failed to write to '%s'", recorder->filename);
+			*length = offset;
+			return ERROR_FAIL;
+		}
+
+		recorder->size += chunk;
+		offset += chunk;
+	}
+
+	fflush(recorder->file);
+
+	return ERROR_OK;
+}
+
+static void recorder_free(struct rtt_recorder *recorder)
+{
+	if (recorder->file)
+		fclose(recorder->file);
+
+	free(recorder->filename);
+	free(recorder);
+}
+
+void rtt_record_exit(void)
+{
+	while (recorders) {
+		struct rtt_recorder *next = recorders->next;
+
+		recorder_free(recorders);
+		recorders = next;
+	}
+}
+
+COMMAND_HANDLER(handle_rtt_record_start_command)
+{
+	unsigned int channel;
+	uint64_t max_size = 0;
+	unsigned int max_files = 1;
+
+	if (CMD_ARGC < 2 || CMD_ARGC > 4)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], channel);
+
+	if (CMD_ARGC >= 3)
+		COMMAND_PARSE_NUMBER(u64, CMD_ARGV[2], max_size);
+
+	if (CMD_ARGC >= 4)
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[3], max_files);
+
+	for (struct rtt_recorder *r = recorders; r; r = r->next) {
+		if (r->channel == channel) {
+			command_print(CMD, "Channel %u is already being recorded", channel);
+			return ERROR_FAIL;
+		}
+	}
+
+	struct rtt_recorder *recorder = calloc(1, sizeof(*recorder));
+
+	if (!recorder) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	recorder->channel = channel;
+	recorder->max_size = max_size;
+	recorder->max_files = max_files;
+	recorder->filename = strdup(CMD_ARGV[1]);
+
+	if (!recorder->filename) {
+		LOG_ERROR("Out of memory");
+		free(recorder);
+		return ERROR_FAIL;
+	}
+
+	recorder->file = fopen(recorder->filename, "wb");
+
+	if (!recorder->file) {
+		command_print(CMD, "Failed to open '%s'", recorder->filename);
+		recorder_free(recorder);
+		return ERROR_FAIL;
+	}
+
+	char *name = alloc_printf("file:%s", recorder->filename);
+
+	if (!name) {
+		LOG_ERROR("Out of memory");
+		recorder_free(recorder);
+		return ERROR_FAIL;
+	}
+
+	int ret = rtt_register_sink(channel, name, &recorder_read, recorder);
+	free(name);
+
+	if (ret != ERROR_OK) {
+		recorder_free(recorder);
+		return ret;
+	}
+
+	recorder->next = recorders;
+	recorders = recorder;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_rtt_record_stop_command)
+{
+	unsigned int channel;
+
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], channel);
+
+	for (struct rtt_recorder **r = &recorders; *r; r = &(*r)->next) {
+		struct rtt_recorder *recorder = *r;
+
+		if (recorder->channel != channel)
+			continue;
+
+		rtt_unregister_sink(channel, &recorder_read, recorder);
+		*r = recorder->next;
+		recorder_free(recorder);
+
+		return ERROR_OK;
+	}
+
+	command_print(CMD, "Channel %u is not being recorded", channel);
+
+	return ERROR_FAIL;
+}
+
+const struct command_registration rtt_record_command_handlers[] = {
+	{
+		.name = "start",
+		.handler = handle_rtt_record_start_command,
+		.mode = COMMAND_ANY,
+		.help = "record an up-channel to a file",
+		.usage = "<channel> <filename> [max_size [max_files]]"
+	},
+	{
+		.name = "stop",
+		.handler = handle_rtt_record_stop_command,
+		.mode = COMMAND_ANY,
+		.help = "stop recording an up-channel",
+		.usage = "<channel>"
+	},
+	COMMAND_REGISTRATION_DONE
+};
@@ -19,6 +19,23 @@
 
 #include "rtt.h"
 
+/**
+ * Host-side store of an up-channel.
+ *
+ * Data read from the target is appended once and then consumed by every sink
+ * of the channel directly from the store, each at its own position.
+ */
+struct rtt_channel_store {
+	/** Store buffer, allocated when the first sink is registered. */
+	uint8_t *buffer;
+	/** Total number of bytes appended to the store. */
+	uint64_t head;
+	/** Sinks of the channel. */
+	struct rtt_sink_list *sinks;
+	/** Sink entry handed to the RTT source to append data to the store. */
+	struct rtt_sink_list input;
+};
+
 static struct {
 	struct rtt_source source;
 	/** Control block. */
@@ -39,8 +56,13 @@ static struct {
 	/** Whether the control block was found. */
 	bool found_cb;
 
+	/** Channel stores, one per up-channel. */
+	struct rtt_channel_store *stores;
+	/** Sink lists passed to the RTT source, one per up-channel. */
 	struct rtt_sink_list **sink_list;
 	size_t sink_list_length;
+	/** Size of each channel store in bytes, a power of two. */
+	size_t store_size;
 
 	unsigned int polling_interval;
 } rtt;
@@ -54,21 +76,114 @@ int rtt_init(void)
 	if (!rtt.sink_list)
 		return ERROR_FAIL;
 
+	rtt.stores = calloc(rtt.sink_list_length,
+		sizeof(struct rtt_channel_store));
+
+	if (!rtt.stores) {
+		free(rtt.sink_list);
+		return ERROR_FAIL;
+	}
+
 	rtt.sink_list[0] = NULL;
 	rtt.started = false;
 
 	rtt.polling_interval = 100;
+	rtt.store_size = RTT_STORE_DEFAULT_SIZE;
 
 	return ERROR_OK;
 }
 
 int rtt_exit(void)
 {
+	rtt_record_exit();
+
+	for (size_t i = 0; i < rtt.sink_list_length; i++) {
+		struct rtt_sink_list *sink = rtt.stores[i].sinks;
+
+		while (sink) {
+			struct rtt_sink_list *next = sink->next;
+
+			free(sink->name);
+			free(sink);
+			sink = next;
+		}
+
+		free(rtt.stores[i].buffer);
+	}
+
+	free(rtt.stores);
 	free(rtt.sink_list);
 
 	return ERROR_OK;
 }
 
+static int store_write(unsigned int channel, const uint8_t *buffer,
+		size_t *length, void *user_data)
+{
+	struct rtt_channel_store *store = user_data;
+	const size_t mask = rtt.store_size - 1;
+	size_t len = *length;
+
+	/* Only the most recent data is kept if more than the store size arrives. */
+	if (len > rtt.store_size) {
+		buffer += len - rtt.store_size;
+		store->head += len - rtt.store_size;
+		len = rtt.store_size;
+	}
+
+	size_t offset = store->head & mask;
+	size_t first_length = MIN(len, rtt.store_size - offset);
+
+	memcpy(store->buffer + offset, buffer, first_length);
+	memcpy(store->buffer, buffer + first_length, len - first_length);
+	store->head += len;
+
+	return ERROR_OK;
+}
+
+static void drain_sink(unsigned int channel, struct rtt_channel_store *store,
+		struct rtt_sink_list *sink)
+{
+	const size_t mask = rtt.store_size - 1;
+
+	if (store->head - sink->pos > rtt.store_size) {
+		uint64_t lost = store->head - sink->pos - rtt.store_size;
+
+		if (!sink->dropped)
+			LOG_WARNING("rtt: Sink '%s' of channel %u is too slow, data is dropped",
+				sink->name, channel);
+
+		sink->dropped += lost;
+		sink->pos += lost;
+	}
+
+	while (sink->pos != store->head) {
+		size_t offset = sink->pos & mask;
+		size_t available = MIN(store->head - sink->pos,
+			rtt.store_size - offset);
+		size_t length = available;
+
+		if (sink->read(channel, store->buffer + offset, &length,
+				sink->user_data) != ERROR_OK)
+			break;
+
+		sink->pos += length;
+
+		if (length < available)
+			break;
+	}
+}
+
+static void drain_stores(void)
+{
+	for (size_t i = 0; i < rtt.sink_list_length; i++) {
+		struct rtt_channel_store *store = &rtt.stores[i];
+
+		for (struct rtt_sink_list *sink = store->sinks; sink; sink = sink->next)
+			drain_sink(i, store, sink);
+	}
+}
+
 static int read_channel_callback(void *user_data)
 {
 	int ret;
@@ -82,6 +197,8 @@ static int read_channel_callback(void *user_data)
 		return ret;
 	}
 
+	drain_stores();
+
 	return ERROR_OK;
 }
 
@@ -185,6 +302,7 @@ int rtt_stop(void)
 static int adjust_sink_list(size_t length)
 {
 	struct rtt_sink_list **tmp;
+	struct rtt_channel_store *stores;
 
 	if (length <= rtt.sink_list_length)
 		return ERROR_OK;
@@ -194,37 +312,80 @@ static int adjust_sink_list(size_t length)
 	if (!tmp)
 		return ERROR_FAIL;
 
-	for (size_t i = rtt.sink_list_length; i < length; i++)
+	rtt.sink_list = tmp;
+
+	stores = realloc(rtt.stores, sizeof(struct rtt_channel_store) * length);
+
+	if (!stores)
+		return ERROR_FAIL;
+
+	for (size_t i = rtt.sink_list_length; i < length; i++) {
 		tmp[i] = NULL;
+		memset(&stores[i], 0, sizeof(struct rtt_channel_store));
+	}
 
-	rtt.sink_list = tmp;
+	/* The store address changed, refresh the source entries. */
+	for (size_t i = 0; i < length; i++) {
+		stores[i].input.read = &store_write;
+		stores[i].input.user_data = &stores[i];
+
+		if (stores[i].sinks)
+			tmp[i] = &stores[i].input;
+	}
+
+	rtt.stores = stores;
 	rtt.sink_list_length = length;
 
 	return ERROR_OK;
 }
 
-int rtt_register_sink(unsigned int channel_index, rtt_sink_read read,
-		void *user_data)
+int rtt_register_sink(unsigned int channel_index, const char *name,
+		rtt_sink_read read, void *user_data)
 {
 	struct rtt_sink_list *tmp;
+	struct rtt_channel_store *store;
 
 	if (channel_index >= rtt.sink_list_length) {
 		if (adjust_sink_list(channel_index + 1) != ERROR_OK)
 			return ERROR_FAIL;
 	}
 
-	LOG_DEBUG("rtt: Registering sink for channel %u", channel_index);
+	LOG_DEBUG("rtt: Registering sink '%s' for channel %u", name,
+		channel_index);
+
+	store = &rtt.stores[channel_index];
+
+	if (!store->buffer) {
+		store->buffer = malloc(rtt.store_size);
+
+		if (!store->buffer)
+			return ERROR_FAIL;
+
+		store->head = 0;
+		store->input.read = &store_write;
+		store->input.user_data = store;
+	}
 
 	tmp = malloc(sizeof(struct rtt_sink_list));
 
 	if (!tmp)
 		return ERROR_FAIL;
 
+	tmp->name = strdup(name);
+
+	if (!tmp->name) {
+		free(tmp);
+		return ERROR_FAIL;
+	}
+
 	tmp->read = read;
 	tmp->user_data = user_data;
-	tmp->next = rtt.sink_list[channel_index];
+	tmp->pos = store->head;
+	tmp->dropped = 0;
+	tmp->next = store->sinks;
 
-	rtt.sink_list[channel_index] = tmp;
+	store->sinks = tmp;
+	rtt.sink_list[channel_index] = &store->input;
 
 	return ERROR_OK;
 }
@@ -232,6 +393,7 @@ int rtt_register_sink(unsigned int channel_index, rtt_sink_read read,
 int rtt_unregister_sink(unsigned int channel_index, rtt_sink_read read,
 		void *user_data)
 {
+	struct rtt_channel_store *store;
 	struct rtt_sink_list *prev_sink;
 
 	LOG_DEBUG("rtt: Unregistering sink for channel %u", channel_index);
@@ -239,26 +401,77 @@ int rtt_unregister_sink(unsigned int channel_index, rtt_sink_read read,
 	if (channel_index >= rtt.sink_list_length)
 		return ERROR_FAIL;
 
-	prev_sink = rtt.sink_list[channel_index];
+	store = &rtt.stores[channel_index];
+	prev_sink = store->sinks;
 
-	for (struct rtt_sink_list *sink = rtt.sink_list[channel_index]; sink;
+	for (struct rtt_sink_list *sink = store->sinks; sink;
 			prev_sink = sink, sink = sink->next) {
 		if (sink->read == read && sink->user_data == user_data) {
 
-			if (sink == rtt.sink_list[channel_index])
-				rtt.sink_list[channel_index] = sink->next;
+			if (sink == store->sinks)
+				store->sinks = sink->next;
 			else
 				prev_sink->next = sink->next;
 
+			free(sink->name);
 			free(sink);
 
-			return ERROR_OK;
+			break;
 		}
 	}
 
+	if (!store->sinks) {
+		rtt.sink_list[channel_index] = NULL;
+		free(store->buffer);
+		store->buffer = NULL;
+	}
+
 	return ERROR_OK;
 }
 
+size_t rtt_get_store_size(void)
+{
+	return rtt.store_size;
+}
+
+int rtt_set_store_size(size_t size)
+{
+	size_t store_size = RTT_CHANNEL_BUFFER_MIN_SIZE;
+
+	if (!size)
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+
+	for (size_t i = 0; i < rtt.sink_list_length; i++) {
+		if (rtt.stores[i].sinks) {
+			LOG_ERROR("rtt: Store size cannot be changed while sinks are registered");
+			return ERROR_FAIL;
+		}
+	}
+
+	while (store_size < size) {
+		if (store_size > SIZE_MAX / 2)
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+
+		store_size <<= 1;
+	}
+
+	rtt.store_size = store_size;
+
+	return ERROR_OK;
+}
+
+void rtt_print_sinks(struct command_invocation *cmd)
+{
+	for (size_t i = 0; i < rtt.sink_list_length; i++) {
+		const struct rtt_channel_store *store = &rtt.stores[i];
+
+		for (const struct rtt_sink_list *sink = store->sinks; sink;
+				sink = sink->next)
+			command_print(cmd, "%zu: %s lag %" PRIu64 " dropped %" PRIu64,
+				i, sink->name, store->head - sink->pos, sink->dropped);
+	}
+}
+
 int rtt_get_polling_interval(unsigned int *interval)
 {
 	if (!interval)
@@ -27,6 +27,9 @@
 /* Minimal channel buffer size in bytes. */
 #define RTT_CHANNEL_BUFFER_MIN_SIZE	2
 
+/* Default size of the host-side store of an up-channel in bytes. */
+#define RTT_STORE_DEFAULT_SIZE	(64 * 1024)
+
 /** RTT control block. */
 struct rtt_control {
 	/** Control block address on the target. */
@@ -77,12 +80,33 @@ struct rtt_channel_info {
 	uint32_t flags;
 };
 
+/**
+ * Sink read callback.
+ *
+ * The buffer points directly into the channel store and is shared by all
+ * sinks of the channel, it must not be modified. The callback must not block.
+ *
+ * @param[in] channel Channel index.
+ * @param[in] buffer Data available to the sink.
+ * @param[in,out] length Number of bytes available. On return, the number of
+ *                       bytes consumed by the sink. Bytes not consumed are
+ *                       offered again on the next polling cycle.
+ * @param[in,out] user_data User data passed on registration.
+ *
+ * @returns ERROR_OK on success, an error code on failure.
+ */
 typedef int (*rtt_sink_read)(unsigned int channel, const uint8_t *buffer,
-		size_t length, void *user_data);
+		size_t *length, void *user_data);
 
 struct rtt_sink_list {
 	rtt_sink_read read;
 	void *user_data;
+	/** Sink name, for diagnostics only. */
+	char *name;
+	/** Absolute store position of the next byte to be consumed. */
+	uint64_t pos;
+	/** Number of bytes lost because the sink fell behind by more than the store size. */
+	uint64_t dropped;
 
 	struct rtt_sink_list *next;
 };
@@ -222,14 +246,19 @@ int rtt_read_channel_info(unsigned int channel_index,
 /**
  * Register an RTT sink.
  *
+ * Each sink consumes the data of the up-channel at its own pace from a store
+ * shared by all sinks of the channel. A new sink only receives data that
+ * arrives after its registration.
+ *
  * @param[in] channel_index Channel index.
+ * @param[in] name Sink name used for diagnostics.
  * @param[in] read Read callback function.
  * @param[in,out] user_data User data to be passed to the callback function.
  *
  * @returns ERROR_OK on success, an error code on failure.
  */
-int rtt_register_sink(unsigned int channel_index, rtt_sink_read read,
-		void *user_data);
+int rtt_register_sink(unsigned int channel_index, const char *name,
+		rtt_sink_read read, void *user_data);
 
 /**
  * Unregister an RTT sink.
@@ -243,6 +272,32 @@ int rtt_register_sink(unsigned int channel_index, rtt_sink_read read,
 int rtt_unregister_sink(unsigned int channel_index, rtt_sink_read read,
 		void *user_data);
 
+/**
+ * Get the size of the host-side store of each up-channel.
+ *
+ * @returns Store size in bytes.
+ */
+size_t rtt_get_store_size(void);
+
+/**
+ * Set the size of the host-side store of each up-channel.
+ *
+ * The size is rounded up to the next power of two. It can only be changed
+ * while no sinks are registered.
+ *
+ * @param[in] size Store size in bytes.
+ *
+ * @returns ERROR_OK on success, an error code on failure.
+ */
+int rtt_set_store_size(size_t size);
+
+/**
+ * Print the state of all registered sinks.
+ *
+ * @param[in] cmd Command invocation to print to.
+ */
+void rtt_print_sinks(struct command_invocation *cmd);
+
 /**
  * Write to an RTT channel.
  *
@@ -256,6 +311,12 @@ int rtt_unregister_sink(unsigned int channel_index, rtt_sink_read read,
 int rtt_write_channel(unsigned int channel_index, const uint8_t *buffer,
 		size_t *length);
 
+/**
+ * Close and free all recorders. Their sinks are freed by rtt_exit().
+ */
+void rtt_record_exit(void);
+
 extern const struct command_registration rtt_target_command_handlers[];
+extern const struct command_registration rtt_record_command_handlers[];
 
 #endif /* OPENOCD_RTT_RTT_H */
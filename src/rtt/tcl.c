@@ -218,6 +218,38 @@ COMMAND_HANDLER(handle_channel_list)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_rtt_store_size_command)
+{
+	if (CMD_ARGC == 0) {
+		command_print(CMD, "%zu bytes", rtt_get_store_size());
+	} else if (CMD_ARGC == 1) {
+		int ret;
+		unsigned int size;
+
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], size);
+		ret = rtt_set_store_size(size);
+
+		if (ret != ERROR_OK) {
+			command_print(CMD, "Failed to set store size");
+			return ret;
+		}
+	} else {
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_rtt_sinks_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	rtt_print_sinks(CMD);
+
+	return ERROR_OK;
+}
+
 static const struct command_registration rtt_subcommand_handlers[] = {
 	{
 		.name = "setup",
@@ -261,6 +293,27 @@ static const struct command_registration rtt_subcommand_handlers[] = {
 		.help = "list available channels",
 		.usage = ""
 	},
+	{
+		.name = "store_size",
+		.handler = handle_rtt_store_size_command,
+		.mode = COMMAND_ANY,
+		.help = "show or set the host-side store size of each up-channel",
+		.usage = "[size]"
+	},
+	{
+		.name = "sinks",
+		.handler = handle_rtt_sinks_command,
+		.mode = COMMAND_EXEC,
+		.help = "list sinks with their lag and dropped bytes",
+		.usage = ""
+	},
+	{
+		.name = "record",
+		.mode = COMMAND_ANY,
+		.help = "record up-channels to files",
+		.usage = "",
+		.chain = rtt_record_command_handlers
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -1298,9 +1298,19 @@ static int gdb_get_registers_packet(struct connection *connection,
 
 	assert(reg_packet_size > 0);
 
+	/* Fetch as many registers as possible at once, the loop below reads
+	 * the rest one by one. */
+	retval = target_read_registers(target, reg_list, reg_list_size);
+	if (retval != ERROR_OK && gdb_report_register_access_error) {
+		free(reg_list);
+		return gdb_error(connection, retval);
+	}
+
 	reg_packet = malloc(reg_packet_size + 1); /* plus one for string termination null */
-	if (!reg_packet)
+	if (!reg_packet) {
+		free(reg_list);
 		return ERROR_FAIL;
+	}
 
 	reg_packet_p = reg_packet;
 
@@ -1389,9 +1399,16 @@ static int gdb_set_registers_packet(struct connection *connection,
 		free(bin_buf);
 	}
 
+	retval = target_write_registers(target, reg_list, reg_list_size);
+
 	/* free struct reg *reg_list[] array allocated by get_gdb_reg_list */
 	free(reg_list);
 
+	if (retval != ERROR_OK && gdb_report_register_access_error) {
+		LOG_DEBUG("Couldn't write registers.");
+		return gdb_error(connection, retval);
+	}
+
 	gdb_put_packet(connection, "OK", 2);
 
 	return ERROR_OK;
@@ -35,26 +35,37 @@ struct rtt_connection_data {
 };
 
 static int read_callback(unsigned int channel, const uint8_t *buffer,
-		size_t length, void *user_data)
+		size_t *length, void *user_data)
 {
 	int ret;
 	struct connection *connection;
-	size_t offset;
 
 	connection = (struct connection *)user_data;
-	offset = 0;
 
-	while (offset < length) {
-		ret = connection_write(connection, buffer + offset, length - offset);
+	/*
+	 * The socket is non-blocking. Whatever the client does not accept now
+	 * stays in the channel store and is sent on the next polling cycle.
+	 */
+	ret = connection_write(connection, buffer, MIN(*length, INT_MAX));
 
-		if (ret < 0) {
-			LOG_ERROR("Failed to write data to socket.");
-			return ERROR_FAIL;
-		}
+	if (ret < 0) {
+		*length = 0;
+
+#ifdef _WIN32
+		bool retry = (WSAGetLastError() == WSAEWOULDBLOCK);
+#else
+		bool retry = (errno == EAGAIN || errno == EWOULDBLOCK);
+#endif
 
-		offset += ret;
+		if (retry)
+			return ERROR_OK;
+
+		LOG_ERROR("Failed to write data to socket.");
+		return ERROR_FAIL;
 	}
 
+	*length = ret;
+
 	return ERROR_OK;
 }
 
@@ -76,7 +87,10 @@ static int rtt_new_connection(struct connection *connection)
 
 	LOG_DEBUG("rtt: New connection for channel %u", service->channel);
 
-	ret = rtt_register_sink(service->channel, &read_callback, connection);
+	char name[32];
+	snprintf(name, sizeof(name), "tcp:%s", connection->service->port);
+
+	ret = rtt_register_sink(service->channel, name, &read_callback, connection);
 
 	if (ret != ERROR_OK)
 		return ret;
@@ -432,8 +432,6 @@ int server_loop(struct command_context *command_context)
 	/* used in accept() */
 	int retval;
 
-	int64_t next_event = timeval_ms() + polling_period;
-
 #ifndef _WIN32
 	if (signal(SIGPIPE, SIG_IGN) == SIG_ERR)
 		LOG_ERROR("couldn't set SIGPIPE to SIG_IGN");
@@ -474,13 +472,17 @@ int server_loop(struct command_context *command_context)
 			tv.tv_usec = 0;
 			retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
 		} else {
-			/* Timeout socket_select() when a target timer expires or every polling_period */
-			int timeout_ms = next_event - timeval_ms();
+			/* Timeout socket_select() when a target timer expires or every polling_period.
+			 * Timers may have been registered since the callbacks last ran, e.g. the
+			 * early poll after a resume, so ask for the next event again. */
+			int timeout_ms = target_timer_next_event() - timeval_ms();
 			if (timeout_ms < 0)
 				timeout_ms = 0;
 			else if (timeout_ms > polling_period)
 				timeout_ms = polling_period;
 			tv.tv_usec = timeout_ms * 1000;
+			/* Nothing is logged while we sleep; write out what is buffered */
+			log_flush();
 			/* Only while we're sleeping we'll let others run */
 			retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
 		}
@@ -514,7 +516,6 @@ int server_loop(struct command_context *command_context)
 			 *   timers expired or the polling period elapsed
 			 */
 			target_call_timer_callbacks();
-			next_event = target_timer_next_event();
 			process_jim_events(command_context);
 
 			FD_ZERO(&read_fds);	/* eCos leaves read_fds unchanged in this case!  */
@@ -601,6 +602,10 @@ int server_loop(struct command_context *command_context)
 
 static void sig_handler(int sig)
 {
+	/* abort() terminates the process once this handler returns */
+	if (sig == SIGABRT)
+		log_flush();
+
 	/* store only first signal that hits us */
 	if (shutdown_openocd == CONTINUE_MAIN_LOOP) {
 		shutdown_openocd = SHUTDOWN_WITH_SIGNAL_CODE;
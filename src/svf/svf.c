@@ -205,10 +205,15 @@ struct svf_check_tdo_para {
 static struct svf_check_tdo_para *svf_check_tdo_para;
 static int svf_check_tdo_para_index;
 
+/* svf_read_command_from_file() reached the end of the file */
+#define SVF_EOF		1
+
 static int svf_read_command_from_file(FILE *fd);
 static int svf_check_tdo(void);
 static int svf_add_check_para(uint8_t enabled, int buffer_offset, int bit_len);
 static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str);
+static int svf_run_parsed_command(struct command_context *cmd_ctx, char **argus,
+		const uint8_t **data, int num_of_argu);
 static int svf_execute_tap(void);
 
 static FILE *svf_fd;
@@ -219,6 +224,48 @@ static size_t svf_command_buffer_size;
 static int svf_line_number;
 static int svf_getline(char **lineptr, size_t *n, FILE *stream);
 
+#define SVF_MAX_NUM_OF_ARGU		256
+
+/*
+ * Compiled SVF file, stored next to the SVF file with SVF_CACHE_SUFFIX.
+ *
+ * The header holds SVF_CACHE_MAGIC, the version, the number of commands and
+ * the hash and size of the SVF file it was compiled from. Each command is
+ * stored as its line number and number of arguments, followed by the
+ * arguments. An argument is a type byte and a length, both little endian,
+ * followed by a NUL terminated string or, for the TDI, TDO, MASK and SMASK
+ * values of scan and padding commands, by the binary value.
+ */
+#define SVF_CACHE_SUFFIX		".cache"
+#define SVF_CACHE_MAGIC			"OCDSVFC"
+#define SVF_CACHE_VERSION		1
+#define SVF_CACHE_HEADER_SIZE	32
+#define SVF_CACHE_ARG_STRING	0
+#define SVF_CACHE_ARG_DATA		1
+
+struct svf_cache {
+	uint8_t *data;
+	size_t size;
+	/* read position, or number of bytes written */
+	size_t pos;
+	uint32_t num_commands;
+};
+
+/* cache being replayed, and cache being compiled */
+static struct svf_cache svf_cache_in, svf_cache_out;
+static uint8_t *svf_cache_scratch;
+static int svf_cache_scratch_len;
+static bool svf_cache_enabled;
+/* placeholder for binary values in the argument list */
+static const char svf_cache_data_argu[] = "()";
+static uint64_t svf_source_hash, svf_source_size;
+
+static int svf_cache_load(const char *filename);
+static int svf_cache_add_command(char **argus, int num_of_argu);
+static int svf_cache_save(const char *filename);
+static int svf_run_cache(struct command_context *cmd_ctx, int *command_num);
+static void svf_cache_free(void);
+
 #define SVF_MAX_BUFFER_SIZE_TO_COMMIT   (1024 * 1024)
 static uint8_t *svf_tdi_buffer, *svf_tdo_buffer, *svf_mask_buffer;
 static int svf_buffer_index, svf_buffer_size;
@@ -349,6 +396,7 @@ int svf_add_statemove(enum tap_state state_to)
 
 enum svf_cmd_param {
 	OPT_ADDCYCLES,
+	OPT_CACHE,
 	OPT_IGNORE_ERROR,
 	OPT_NIL,
 	OPT_NORESET,
@@ -364,6 +412,7 @@ enum svf_cmd_param {
 
 static const struct nvp svf_cmd_opts[] = {
 	{ .name = "-addcycles",    .value = OPT_ADDCYCLES },
+	{ .name = "-cache",        .value = OPT_CACHE },
 	{ .name = "-ignore_error", .value = OPT_IGNORE_ERROR },
 	{ .name = "-nil",          .value = OPT_NIL },
 	{ .name = "-noreset",      .value = OPT_NORESET },
@@ -381,8 +430,9 @@ static const struct nvp svf_cmd_opts[] = {
 COMMAND_HANDLER(handle_svf_command)
 {
 #define SVF_MIN_NUM_OF_OPTIONS 1
-#define SVF_MAX_NUM_OF_OPTIONS 8
+#define SVF_MAX_NUM_OF_OPTIONS 9
 	int command_num = 0;
+	const char *filename = NULL;
 	int ret = ERROR_OK;
 	int64_t time_measure_ms;
 	int time_measure_s, time_measure_m;
@@ -404,6 +454,7 @@ COMMAND_HANDLER(handle_svf_command)
 	svf_ignore_error = 0;
 	svf_noreset = false;
 	svf_addcycles = 0;
+	svf_cache_enabled = false;
 
 	for (unsigned int i = 0; i < CMD_ARGC; i++) {
 		const struct nvp *n = nvp_name2value(svf_cmd_opts, CMD_ARGV[i]);
@@ -464,6 +515,10 @@ COMMAND_HANDLER(handle_svf_command)
 			svf_noreset = true;
 			break;
 
+		case OPT_CACHE:
+			svf_cache_enabled = true;
+			break;
+
 		default:
 			svf_fd = fopen(CMD_ARGV[i], "r");
 			if (!svf_fd) {
@@ -473,6 +528,7 @@ COMMAND_HANDLER(handle_svf_command)
 				return ERROR_COMMAND_SYNTAX_ERROR;
 			}
 			LOG_USER("svf processing file: \"%s\"", CMD_ARGV[i]);
+			filename = CMD_ARGV[i];
 			break;
 		}
 	}
@@ -560,15 +616,35 @@ COMMAND_HANDLER(handle_svf_command)
 		}
 	}
 
-	if (svf_progress_enabled) {
+	/* use the compiled file if it is fresh, or compile it on the way */
+	if (svf_cache_load(filename) == ERROR_OK) {
+		LOG_USER("svf using compiled file \"%s" SVF_CACHE_SUFFIX "\"", filename);
+		ret = svf_run_cache(CMD_CTX, &command_num);
+	} else if (svf_cache_enabled) {
+		svf_cache_out.pos = SVF_CACHE_HEADER_SIZE;
+	}
+
+	if (svf_progress_enabled && !svf_cache_in.data) {
 		/* Count total lines in file. */
 		while (!feof(svf_fd)) {
-			svf_getline(&svf_command_buffer, &svf_command_buffer_size, svf_fd);
+			if (svf_getline(&svf_command_buffer, &svf_command_buffer_size, svf_fd) < 0) {
+				ret = ERROR_FAIL;
+				goto free_all;
+			}
 			svf_total_lines++;
 		}
 		rewind(svf_fd);
 	}
-	while (svf_read_command_from_file(svf_fd) == ERROR_OK) {
+	while (!svf_cache_in.data) {
+		int read_ret = svf_read_command_from_file(svf_fd);
+		if (read_ret != ERROR_OK) {
+			if (read_ret != SVF_EOF) {
+				LOG_ERROR("fail to read command at line %d", svf_line_number);
+				ret = read_ret;
+			}
+			break;
+		}
+
 		/* Log Output */
 		if (svf_quiet) {
 			if (svf_progress_enabled) {
@@ -599,6 +675,11 @@ COMMAND_HANDLER(handle_svf_command)
 	else if (svf_check_tdo() != ERROR_OK)
 		ret = ERROR_FAIL;
 
+	if (ret == ERROR_OK && svf_cache_enabled && !svf_cache_in.data) {
+		if (svf_cache_save(filename) != ERROR_OK)
+			LOG_WARNING("svf: failed to write compiled file");
+	}
+
 	/* print time */
 	time_measure_ms = timeval_ms() - time_measure_ms;
 	time_measure_s = time_measure_ms / 1000;
@@ -638,6 +719,8 @@ free_all:
 	svf_buffer_index = 0;
 	svf_buffer_size = 0;
 
+	svf_cache_free();
+
 	svf_free_xxd_para(&svf_para.hdr_para);
 	svf_free_xxd_para(&svf_para.hir_para);
 	svf_free_xxd_para(&svf_para.tdr_para);
@@ -658,63 +741,87 @@ free_all:
 	return ret;
 }
 
+/* Returns a positive value when a line was read, 0 at the end of the file,
+ * or an error code */
 static int svf_getline(char **lineptr, size_t *n, FILE *stream)
 {
-#define MIN_CHUNK 16	/* Buffer is increased by this size each time as required */
+#define MIN_CHUNK 16	/* Initial buffer size, doubled each time as required */
 	size_t i = 0;
 
 	if (!*lineptr) {
 		*n = MIN_CHUNK;
 		*lineptr = malloc(*n);
-		if (!*lineptr)
-			return -1;
+		if (!*lineptr) {
+			LOG_ERROR("not enough memory");
+			return ERROR_FAIL;
+		}
 	}
 
-	(*lineptr)[0] = fgetc(stream);
-	while ((*lineptr)[i] != '\n') {
-		(*lineptr)[++i] = fgetc(stream);
-		if (feof(stream)) {
-			(*lineptr)[0] = 0;
-			return -1;
-		}
+	/* Read whole chunks; FPGA bitstreams come with very long lines. */
+	while (fgets(*lineptr + i, *n - i, stream)) {
+		i += strlen(*lineptr + i);
+		if (i > 0 && (*lineptr)[i - 1] == '\n')
+			return sizeof(*lineptr);
+
 		if ((i + 2) > *n) {
-			*n += MIN_CHUNK;
-			*lineptr = realloc(*lineptr, *n);
+			char *line = realloc(*lineptr, *n * 2);
+			if (!line) {
+				LOG_ERROR("not enough memory");
+				(*lineptr)[0] = 0;
+				return ERROR_FAIL;
+			}
+			*lineptr = line;
+			*n *= 2;
 		}
 	}
 
-	(*lineptr)[++i] = 0;
+	/* a last line without newline is dropped, as before */
+	(*lineptr)[0] = 0;
+	return 0;
+}
+
+/* Reads the next line of svf_fd into svf_read_line */
+static int svf_read_next_line(void)
+{
+	int ret = svf_getline(&svf_read_line, &svf_read_line_size, svf_fd);
+	if (ret < 0)
+		return ret;
 
-	return sizeof(*lineptr);
+	return ret ? ERROR_OK : SVF_EOF;
 }
 
 #define SVFP_CMD_INC_CNT 1024
+/* Returns ERROR_OK when a command was read into svf_command_buffer, SVF_EOF
+ * at the end of the file, or an error code */
 static int svf_read_command_from_file(FILE *fd)
 {
 	unsigned char ch;
 	int i = 0;
 	size_t cmd_pos = 0;
 	int cmd_ok = 0, slash = 0;
+	int ret;
 
-	if (svf_getline(&svf_read_line, &svf_read_line_size, svf_fd) <= 0)
-		return ERROR_FAIL;
+	ret = svf_read_next_line();
+	if (ret != ERROR_OK)
+		return ret;
 	svf_line_number++;
 	ch = svf_read_line[0];
 	while (!cmd_ok && (ch != 0)) {
 		switch (ch) {
 		case '!':
 			slash = 0;
-			if (svf_getline(&svf_read_line, &svf_read_line_size, svf_fd) <= 0)
-				return ERROR_FAIL;
+			ret = svf_read_next_line();
+			if (ret != ERROR_OK)
+				return ret;
 			svf_line_number++;
 			i = -1;
 			break;
 		case '/':
 			if (++slash == 2) {
 				slash = 0;
-				if (svf_getline(&svf_read_line, &svf_read_line_size,
-					svf_fd) <= 0)
-					return ERROR_FAIL;
+				ret = svf_read_next_line();
+				if (ret != ERROR_OK)
+					return ret;
 				svf_line_number++;
 				i = -1;
 			}
@@ -725,8 +832,9 @@ static int svf_read_command_from_file(FILE *fd)
 			break;
 		case '\n':
 			svf_line_number++;
-			if (svf_getline(&svf_read_line, &svf_read_line_size, svf_fd) <= 0)
-				return ERROR_FAIL;
+			ret = svf_read_next_line();
+			if (ret != ERROR_OK)
+				return ret;
 			i = -1;
 			/* fallthrough */
 		case '\r':
@@ -749,8 +857,9 @@ static int svf_read_command_from_file(FILE *fd)
 			 *  - terminating NUL ('\0')
 			 */
 			if (cmd_pos + 3 > svf_command_buffer_size) {
-				svf_command_buffer = realloc(svf_command_buffer, cmd_pos + 3);
-				svf_command_buffer_size = cmd_pos + 3;
+				/* grow geometrically, commands can be megabytes long */
+				svf_command_buffer_size = MAX(cmd_pos + 3, svf_command_buffer_size * 2);
+				svf_command_buffer = realloc(svf_command_buffer, svf_command_buffer_size);
 				if (!svf_command_buffer) {
 					LOG_ERROR("not enough memory");
 					return ERROR_FAIL;
@@ -775,7 +884,7 @@ static int svf_read_command_from_file(FILE *fd)
 		svf_command_buffer[cmd_pos] = '\0';
 		return ERROR_OK;
 	} else
-		return ERROR_FAIL;
+		return SVF_EOF;
 }
 
 static int svf_parse_cmd_string(char *str, int len, char **argus, int *num_of_argu)
@@ -981,7 +1090,8 @@ static int svf_execute_tap(void)
 	return ERROR_OK;
 }
 
-static int svf_xxr_common(char **argus, int num_of_argu, char command, struct svf_xxr_para *xxr_para_tmp)
+static int svf_xxr_common(char **argus, const uint8_t **data, int num_of_argu, char command,
+		struct svf_xxr_para *xxr_para_tmp)
 {
 	int i, i_tmp;
 	uint8_t **pbuffer_tmp;
@@ -1010,12 +1120,16 @@ static int svf_xxr_common(char **argus, int num_of_argu, char command, struct sv
 	LOG_DEBUG("\tlength = %d", xxr_para_tmp->len);
 	xxr_para_tmp->data_mask = 0;
 	for (i = 2; i < num_of_argu; i += 2) {
-		if ((strlen(argus[i + 1]) < 3) || (argus[i + 1][0] != '(') ||
+		/* values from a compiled file are binary already */
+		if (data && data[i + 1]) {
+			/* checked when loading */
+		} else if ((strlen(argus[i + 1]) < 3) || (argus[i + 1][0] != '(') ||
 				argus[i + 1][strlen(argus[i + 1]) - 1] != ')') {
 			LOG_ERROR("data section error");
 			return ERROR_FAIL;
+		} else {
+			argus[i + 1][strlen(argus[i + 1]) - 1] = '\0';
 		}
-		argus[i + 1][strlen(argus[i + 1]) - 1] = '\0';
 		/* TDI, TDO, MASK, SMASK */
 		if (!strcmp(argus[i], "TDI")) {
 			/* TDI */
@@ -1037,7 +1151,13 @@ static int svf_xxr_common(char **argus, int num_of_argu, char command, struct sv
 			LOG_ERROR("unknown parameter: %s", argus[i]);
 			return ERROR_FAIL;
 		}
-		if (svf_copy_hexstring_to_binary(&argus[i + 1][1], pbuffer_tmp, i_tmp,
+		if (data && data[i + 1]) {
+			if (svf_adjust_array_length(pbuffer_tmp, i_tmp, xxr_para_tmp->len) != ERROR_OK) {
+				LOG_ERROR("fail to adjust length of array");
+				return ERROR_FAIL;
+			}
+			memcpy(*pbuffer_tmp, data[i + 1], (xxr_para_tmp->len + 7) >> 3);
+		} else if (svf_copy_hexstring_to_binary(&argus[i + 1][1], pbuffer_tmp, i_tmp,
 				xxr_para_tmp->len) != ERROR_OK) {
 			LOG_ERROR("fail to parse hex value");
 			return ERROR_FAIL;
@@ -1268,8 +1388,28 @@ static int svf_xxr_common(char **argus, int num_of_argu, char command, struct sv
 
 static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 {
-	char *argus[256], command;
-	int num_of_argu = 0, i, retval;
+	char *argus[SVF_MAX_NUM_OF_ARGU];
+	int num_of_argu = 0;
+
+	if (svf_parse_cmd_string(cmd_str, strlen(cmd_str), argus, &num_of_argu) != ERROR_OK)
+		return ERROR_FAIL;
+
+	/* compiling? */
+	if (svf_cache_out.pos && svf_cache_add_command(argus, num_of_argu) != ERROR_OK) {
+		LOG_WARNING("svf: cannot compile line %d, not writing a compiled file",
+				svf_line_number);
+		svf_cache_enabled = false;
+		svf_cache_free();
+	}
+
+	return svf_run_parsed_command(cmd_ctx, argus, NULL, num_of_argu);
+}
+
+static int svf_run_parsed_command(struct command_context *cmd_ctx, char **argus,
+		const uint8_t **data, int num_of_argu)
+{
+	char command;
+	int i, retval;
 
 	/* tmp variable */
 	int i_tmp;
@@ -1282,9 +1422,6 @@ static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 	/* flag padding commands skipped due to -tap command */
 	int padding_command_skipped = 0;
 
-	if (svf_parse_cmd_string(cmd_str, strlen(cmd_str), argus, &num_of_argu) != ERROR_OK)
-		return ERROR_FAIL;
-
 	/* NOTE: we're a bit loose here, because we ignore case in
 	 * TAP state names (instead of insisting on uppercase).
 	 */
@@ -1347,7 +1484,7 @@ static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 			padding_command_skipped = 1;
 			break;
 		}
-		retval = svf_xxr_common(argus, num_of_argu, command, &svf_para.hdr_para);
+		retval = svf_xxr_common(argus, data, num_of_argu, command, &svf_para.hdr_para);
 		if (retval != ERROR_OK)
 			return retval;
 		break;
@@ -1356,7 +1493,7 @@ static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 			padding_command_skipped = 1;
 			break;
 		}
-		retval = svf_xxr_common(argus, num_of_argu, command, &svf_para.hir_para);
+		retval = svf_xxr_common(argus, data, num_of_argu, command, &svf_para.hir_para);
 		if (retval != ERROR_OK)
 			return retval;
 		break;
@@ -1365,7 +1502,7 @@ static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 			padding_command_skipped = 1;
 			break;
 		}
-		retval = svf_xxr_common(argus, num_of_argu, command, &svf_para.tdr_para);
+		retval = svf_xxr_common(argus, data, num_of_argu, command, &svf_para.tdr_para);
 		if (retval != ERROR_OK)
 			return retval;
 		break;
@@ -1374,17 +1511,17 @@ static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 			padding_command_skipped = 1;
 			break;
 		}
-		retval = svf_xxr_common(argus, num_of_argu, command, &svf_para.tir_para);
+		retval = svf_xxr_common(argus, data, num_of_argu, command, &svf_para.tir_para);
 		if (retval != ERROR_OK)
 			return retval;
 		break;
 	case SDR:
-		retval = svf_xxr_common(argus, num_of_argu, command, &svf_para.sdr_para);
+		retval = svf_xxr_common(argus, data, num_of_argu, command, &svf_para.sdr_para);
 		if (retval != ERROR_OK)
 			return retval;
 		break;
 	case SIR:
-		retval = svf_xxr_common(argus, num_of_argu, command, &svf_para.sir_para);
+		retval = svf_xxr_common(argus, data, num_of_argu, command, &svf_para.sir_para);
 		if (retval != ERROR_OK)
 			return retval;
 		break;
@@ -1645,6 +1782,314 @@ static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 	return ERROR_OK;
 }
 
+/* FNV-1a hash of the SVF file, to tell whether a compiled file is fresh */
+static int svf_hash_file(FILE *fd)
+{
+	uint8_t buf[64 * 1024];
+	size_t len;
+
+	svf_source_hash = 0xcbf29ce484222325ull;
+	svf_source_size = 0;
+
+	while ((len = fread(buf, 1, sizeof(buf), fd)) > 0) {
+		for (size_t i = 0; i < len; i++) {
+			svf_source_hash ^= buf[i];
+			svf_source_hash *= 0x100000001b3ull;
+		}
+		svf_source_size += len;
+	}
+
+	if (ferror(fd))
+		return ERROR_FAIL;
+
+	rewind(fd);
+	return ERROR_OK;
+}
+
+static int svf_cache_load(const char *filename)
+{
+	char *name = alloc_printf("%s" SVF_CACHE_SUFFIX, filename);
+	if (!name)
+		return ERROR_FAIL;
+
+	FILE *fd = fopen(name, "rb");
+	free(name);
+	if (!fd && !svf_cache_enabled)
+		return ERROR_FAIL;
+
+	if (svf_hash_file(svf_fd) != ERROR_OK || !fd) {
+		if (fd)
+			fclose(fd);
+		return ERROR_FAIL;
+	}
+
+	uint8_t header[SVF_CACHE_HEADER_SIZE];
+	if (fread(header, 1, sizeof(header), fd) != sizeof(header)
+			|| memcmp(header, SVF_CACHE_MAGIC, sizeof(SVF_CACHE_MAGIC)) != 0
+			|| le_to_h_u32(header + 8) != SVF_CACHE_VERSION
+			|| le_to_h_u64(header + 16) != svf_source_hash
+			|| le_to_h_u64(header + 24) != svf_source_size) {
+		LOG_DEBUG("svf: compiled file is missing or stale");
+		fclose(fd);
+		return ERROR_FAIL;
+	}
+
+	/* load everything after the header */
+	struct svf_cache *cache = &svf_cache_in;
+	cache->pos = 0;
+	cache->size = 0;
+	while (!feof(fd) && !ferror(fd)) {
+		size_t size = MAX(cache->size * 2, 1024 * 1024);
+		uint8_t *data = realloc(cache->data, size);
+		if (!data) {
+			LOG_ERROR("not enough memory");
+			break;
+		}
+		cache->data = data;
+		cache->size += fread(cache->data + cache->size, 1, size - cache->size, fd);
+		if (cache->size < size)
+			break;
+	}
+
+	bool ok = !ferror(fd) && feof(fd);
+	fclose(fd);
+	if (!ok) {
+		svf_cache_free();
+		return ERROR_FAIL;
+	}
+
+	cache->num_commands = le_to_h_u32(header + 12);
+	return ERROR_OK;
+}
+
+static int svf_cache_put(const void *buf, size_t len)
+{
+	struct svf_cache *cache = &svf_cache_out;
+
+	if (cache->pos + len > cache->size) {
+		size_t size = MAX(cache->size * 2, cache->pos + len);
+		uint8_t *data = realloc(cache->data, size);
+		if (!data)
+			return ERROR_FAIL;
+		cache->data = data;
+		cache->size = size;
+	}
+
+	memcpy(cache->data + cache->pos, buf, len);
+	cache->pos += len;
+	return ERROR_OK;
+}
+
+static int svf_cache_put_u32(uint32_t value)
+{
+	uint8_t buf[4];
+
+	h_u32_to_le(buf, value);
+	return svf_cache_put(buf, sizeof(buf));
+}
+
+static int svf_cache_put_arg(uint8_t type, const void *arg, uint32_t len)
+{
+	if (svf_cache_put(&type, 1) != ERROR_OK
+			|| svf_cache_put_u32(len) != ERROR_OK
+			|| svf_cache_put(arg, len) != ERROR_OK)
+		return ERROR_FAIL;
+	return ERROR_OK;
+}
+
+/* Store a parsed command, with the values of scans already converted. */
+static int svf_cache_add_command(char **argus, int num_of_argu)
+{
+	int command = svf_find_string_in_array(argus[0],
+			(char **)svf_command_name, ARRAY_SIZE(svf_command_name));
+	bool xxr = command == HDR || command == HIR || command == TDR
+			|| command == TIR || command == SDR || command == SIR;
+	int len = (xxr && num_of_argu > 1) ? atoi(argus[1]) : 0;
+
+	if (svf_cache_put_u32(svf_line_number) != ERROR_OK
+			|| svf_cache_put_u32(num_of_argu) != ERROR_OK)
+		return ERROR_FAIL;
+
+	for (int i = 0; i < num_of_argu; i++) {
+		char *arg = argus[i];
+		size_t arg_len = strlen(arg);
+
+		if (len > 0 && i >= 3 && (i % 2) && arg_len >= 3 && arg[0] == '('
+				&& arg[arg_len - 1] == ')') {
+			arg[arg_len - 1] = '\0';
+			int retval = svf_copy_hexstring_to_binary(&arg[1], &svf_cache_scratch,
+					svf_cache_scratch_len, len);
+			arg[arg_len - 1] = ')';
+			if (retval != ERROR_OK)
+				return retval;
+			svf_cache_scratch_len = MAX(svf_cache_scratch_len, len);
+
+			retval = svf_cache_put_arg(SVF_CACHE_ARG_DATA, svf_cache_scratch,
+					(len + 7) >> 3);
+			if (retval != ERROR_OK)
+				return retval;
+		} else if (svf_cache_put_arg(SVF_CACHE_ARG_STRING, arg, arg_len + 1) != ERROR_OK) {
+			return ERROR_FAIL;
+		}
+	}
+
+	svf_cache_out.num_commands++;
+	return ERROR_OK;
+}
+
+static int svf_cache_save(const char *filename)
+{
+	struct svf_cache *cache = &svf_cache_out;
+
+	/* a file without any command leaves nothing but the header */
+	if (!cache->data) {
+		cache->data = malloc(SVF_CACHE_HEADER_SIZE);
+		if (!cache->data)
+			return ERROR_FAIL;
+		cache->size = SVF_CACHE_HEADER_SIZE;
+	}
+
+	uint8_t *header = cache->data;
+
+	memset(header, 0, SVF_CACHE_HEADER_SIZE);
+	memcpy(header, SVF_CACHE_MAGIC, sizeof(SVF_CACHE_MAGIC));
+	h_u32_to_le(header + 8, SVF_CACHE_VERSION);
+	h_u32_to_le(header + 12, cache->num_commands);
+	h_u64_to_le(header + 16, svf_source_hash);
+	h_u64_to_le(header + 24, svf_source_size);
+
+	char *name = alloc_printf("%s" SVF_CACHE_SUFFIX, filename);
+	char *tmp_name = alloc_printf("%s" SVF_CACHE_SUFFIX ".tmp", filename);
+	int retval = ERROR_FAIL;
+
+	if (!name || !tmp_name)
+		goto out;
+
+	/* write a temporary file first, a partial file must never look fresh */
+	FILE *fd = fopen(tmp_name, "wb");
+	if (!fd)
+		goto out;
+
+	bool ok = fwrite(cache->data, 1, cache->pos, fd) == cache->pos;
+	if (fclose(fd) != 0 || !ok) {
+		remove(tmp_name);
+		goto out;
+	}
+
+	remove(name);
+	if (rename(tmp_name, name) != 0) {
+		remove(tmp_name);
+		goto out;
+	}
+
+	LOG_USER("svf compiled to \"%s\"", name);
+	retval = ERROR_OK;
+
+out:
+	free(name);
+	free(tmp_name);
+	return retval;
+}
+
+static int svf_cache_get_u32(uint32_t *value)
+{
+	struct svf_cache *cache = &svf_cache_in;
+
+	if (cache->size - cache->pos < 4)
+		return ERROR_FAIL;
+
+	*value = le_to_h_u32(cache->data + cache->pos);
+	cache->pos += 4;
+	return ERROR_OK;
+}
+
+static int svf_cache_next_command(char **argus, const uint8_t **data, int *num_of_argu)
+{
+	struct svf_cache *cache = &svf_cache_in;
+	uint32_t line, num;
+
+	if (svf_cache_get_u32(&line) != ERROR_OK || svf_cache_get_u32(&num) != ERROR_OK
+			|| num == 0 || num > SVF_MAX_NUM_OF_ARGU)
+		return ERROR_FAIL;
+
+	for (uint32_t i = 0; i < num; i++) {
+		uint32_t len;
+
+		if (cache->pos == cache->size)
+			return ERROR_FAIL;
+		uint8_t type = cache->data[cache->pos++];
+
+		if (svf_cache_get_u32(&len) != ERROR_OK || cache->size - cache->pos < len)
+			return ERROR_FAIL;
+
+		if (type == SVF_CACHE_ARG_STRING) {
+			if (!len || cache->data[cache->pos + len - 1] != '\0')
+				return ERROR_FAIL;
+			argus[i] = (char *)cache->data + cache->pos;
+			data[i] = NULL;
+		} else if (type == SVF_CACHE_ARG_DATA) {
+			/* only values of scans, sized by their length argument */
+			if (i < 3 || data[1] || len != (uint32_t)((atoi(argus[1]) + 7) >> 3))
+				return ERROR_FAIL;
+			argus[i] = (char *)svf_cache_data_argu;
+			data[i] = cache->data + cache->pos;
+		} else {
+			return ERROR_FAIL;
+		}
+
+		cache->pos += len;
+	}
+
+	svf_line_number = line;
+	*num_of_argu = num;
+	return ERROR_OK;
+}
+
+static int svf_run_cache(struct command_context *cmd_ctx, int *command_num)
+{
+	char *argus[SVF_MAX_NUM_OF_ARGU];
+	const uint8_t *data[SVF_MAX_NUM_OF_ARGU];
+	int num_of_argu;
+
+	for (uint32_t i = 0; i < svf_cache_in.num_commands; i++) {
+		if (svf_cache_next_command(argus, data, &num_of_argu) != ERROR_OK) {
+			LOG_ERROR("svf: compiled file is corrupted");
+			return ERROR_FAIL;
+		}
+
+		/* Log Output */
+		if (svf_progress_enabled) {
+			svf_percentage = ((i * 20) / svf_cache_in.num_commands) * 5;
+			if (svf_last_printed_percentage != svf_percentage) {
+				LOG_USER_N("\r%d%%    ", svf_percentage);
+				svf_last_printed_percentage = svf_percentage;
+			}
+		}
+		if (!svf_quiet)
+			LOG_USER("%s (line %d)", argus[0], svf_line_number);
+
+		/* Run Command */
+		if (svf_run_parsed_command(cmd_ctx, argus, data, num_of_argu) != ERROR_OK) {
+			LOG_ERROR("fail to run command at line %d", svf_line_number);
+			return ERROR_FAIL;
+		}
+		(*command_num)++;
+	}
+
+	return ERROR_OK;
+}
+
+static void svf_cache_free(void)
+{
+	free(svf_cache_in.data);
+	memset(&svf_cache_in, 0, sizeof(svf_cache_in));
+	free(svf_cache_out.data);
+	memset(&svf_cache_out, 0, sizeof(svf_cache_out));
+	free(svf_cache_scratch);
+	svf_cache_scratch = NULL;
+	svf_cache_scratch_len = 0;
+}
+
 static const struct command_registration svf_command_handlers[] = {
 	{
 		.name = "svf",
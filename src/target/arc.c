@@ -438,7 +438,7 @@ static int arc_build_bcr_reg_cache(struct target *target)
 	struct arc_common *arc = target_to_arc(target);
 	const unsigned long num_regs = arc->num_bcr_regs;
 	struct reg_cache **cache_p = register_get_last_cache_p(&target->reg_cache);
-	struct reg_cache *cache = malloc(sizeof(*cache));
+	struct reg_cache *cache = calloc(1, sizeof(*cache));
 	struct reg *reg_list = calloc(num_regs, sizeof(*reg_list));
 
 	struct arc_reg_desc *reg_desc;
@@ -1377,6 +1377,7 @@ static int arc_init_target(struct command_context *cmd_ctx, struct target *targe
 static void arc_free_reg_cache(struct reg_cache *cache)
 {
 	free(cache->reg_list);
+	register_cache_free_index(cache);
 	free(cache);
 }
 
@@ -1765,6 +1766,7 @@ static void arc_reset_actionpoints(struct target *target)
 		free(target->watchpoints);
 		target->watchpoints = next_w;
 	}
+	breakpoint_free_index(target);
 	for (unsigned int i = 0; i < arc->actionpoints_num; i++) {
 		if ((ap_list[i].used) && (ap_list[i].reg_address))
 			arc_remove_auxreg_actionpoint(target, ap_list[i].reg_address);
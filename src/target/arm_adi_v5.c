@@ -188,20 +188,52 @@ static uint32_t mem_ap_get_tar_increment(struct adiv5_ap *ap)
 	return 0;
 }
 
-/* mem_ap_update_tar_cache is called after an access to MEM_AP_REG_DRW
+/* mem_ap_update_tar_cache is called after count accesses to MEM_AP_REG_DRW
  */
-static void mem_ap_update_tar_cache(struct adiv5_ap *ap)
+static void mem_ap_update_tar_cache(struct adiv5_ap *ap, uint32_t count)
 {
 	if (!ap->tar_valid)
 		return;
 
-	uint32_t inc = mem_ap_get_tar_increment(ap);
+	uint32_t inc = mem_ap_get_tar_increment(ap) * count;
 	if (inc >= max_tar_block_size(ap->tar_autoincr_block, ap->tar_value))
 		ap->tar_valid = false;
 	else
 		ap->tar_value += inc;
 }
 
+/* Number of transfers of this_size bytes that can be queued back to back
+ * starting at address, without crossing a TAR autoincrement boundary.
+ */
+static uint32_t mem_ap_block_transfers(struct adiv5_ap *ap, target_addr_t address,
+		size_t nbytes, unsigned int this_size, bool addrinc)
+{
+	size_t block = nbytes;
+
+	if (addrinc)
+		block = MIN(block, max_tar_block_size(ap->tar_autoincr_block, address));
+
+	return MAX(block / this_size, 1);
+}
+
+/* A DRW word transferring 4 bytes starting at address carries the byte for
+ * address N in byte lane N % 4. Rotate the lanes so that the bytes come in
+ * address order, as a little endian word.
+ */
+static inline uint32_t drw_lanes_to_le(uint32_t drw, target_addr_t address)
+{
+	unsigned int shift = 8 * (address & 3);
+
+	return shift ? (drw >> shift) | (drw << (32 - shift)) : drw;
+}
+
+static inline uint32_t le_to_drw_lanes(uint32_t value, target_addr_t address)
+{
+	unsigned int shift = 8 * (address & 3);
+
+	return shift ? (value << shift) | (value >> (32 - shift)) : value;
+}
+
 /**
  * Queue transactions setting up transfer parameters for the
  * currently selected MEM-AP.
@@ -531,14 +563,26 @@ static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t siz
 		if (retval != ERROR_OK)
 			return retval;
 
+		/* Queue all transfers up to the next TAR autoincrement boundary at once.
+		 * The quirk modes need the per-transfer setup done above. */
+		uint32_t transfers = 1;
+		if (!dap->ti_be_32_quirks && !dap->nu_npcx_quirks)
+			transfers = mem_ap_block_transfers(ap, address, nbytes,
+						this_size, addrinc);
+
 		/* How many source bytes each transfer will consume, and their location in the DRW,
 		 * depends on the type of transfer and alignment. See ARM document IHI0031C. */
 		uint32_t drw_byte_idx = address;
-		unsigned int drw_ops = DIV_ROUND_UP(this_size, 4);
+		unsigned int drw_ops = transfers * DIV_ROUND_UP(this_size, 4);
 
 		while (drw_ops--) {
 			uint32_t outvalue = 0;
-			if (dap->nu_npcx_quirks && this_size <= 2) {
+			if (this_size >= 4 && !ti_be_lane_xor) {
+				/* Full DRW word: place all four bytes at once */
+				outvalue = le_to_drw_lanes(le_to_h_u32(buffer), drw_byte_idx);
+				buffer += 4;
+				drw_byte_idx += 4;
+			} else if (dap->nu_npcx_quirks && this_size <= 2) {
 				switch (this_size) {
 				case 2:
 					{
@@ -575,10 +619,10 @@ static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t siz
 		if (retval != ERROR_OK)
 			break;
 
-		mem_ap_update_tar_cache(ap);
-		nbytes -= this_size;
+		mem_ap_update_tar_cache(ap, transfers);
+		nbytes -= transfers * this_size;
 		if (addrinc)
-			address += this_size;
+			address += transfers * this_size;
 	}
 
 	/* REVISIT: Might want to have a queued version of this function that does not run. */
@@ -656,18 +700,23 @@ static int mem_ap_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, uint
 			break;
 
 
-		unsigned int drw_ops = DIV_ROUND_UP(this_size, 4);
+		/* Queue all transfers up to the next TAR autoincrement boundary at once. */
+		uint32_t transfers = mem_ap_block_transfers(ap, address, nbytes,
+					this_size, addrinc);
+		unsigned int drw_ops = transfers * DIV_ROUND_UP(this_size, 4);
 		while (drw_ops--) {
 			retval = dap_queue_ap_read(ap, MEM_AP_REG_DRW(dap), read_ptr++);
 			if (retval != ERROR_OK)
 				break;
 		}
+		if (retval != ERROR_OK)
+			break;
 
-		nbytes -= this_size;
+		nbytes -= transfers * this_size;
 		if (addrinc)
-			address += this_size;
+			address += transfers * this_size;
 
-		mem_ap_update_tar_cache(ap);
+		mem_ap_update_tar_cache(ap, transfers);
 	}
 
 	if (retval == ERROR_OK)
@@ -707,6 +756,16 @@ static int mem_ap_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, uint
 			this_size = 4;	/* Packed read of 4 bytes or 2 halfwords */
 		}
 
+		if (this_size == 4 && !ti_be_lane_xor) {
+			/* Extract all four byte lanes at once */
+			h_u32_to_le(buffer, drw_lanes_to_le(*read_ptr, address));
+			buffer += 4;
+			address += 4;
+			read_ptr++;
+			nbytes -= 4;
+			continue;
+		}
+
 		switch (this_size) {
 		case 4:
 			*buffer++ = *read_ptr >> 8 * ((address++ & 3) ^ ti_be_lane_xor);
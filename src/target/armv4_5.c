@@ -664,7 +664,7 @@ struct reg_cache *arm_build_reg_cache(struct target *target, struct arm *arm)
 	if (arm->arm_vfp_version == ARM_VFP_V3)
 		num_regs += ARRAY_SIZE(arm_vfp_v3_regs);
 
-	struct reg_cache *cache = malloc(sizeof(struct reg_cache));
+	struct reg_cache *cache = calloc(1, sizeof(struct reg_cache));
 	struct reg *reg_list = calloc(num_regs, sizeof(struct reg));
 	struct arm_reg *reg_arch_info = calloc(num_regs, sizeof(struct arm_reg));
 
@@ -786,6 +786,7 @@ void arm_free_reg_cache(struct arm *arm)
 
 	free(cache->reg_list[0].arch_info);
 	free(cache->reg_list);
+	register_cache_free_index(cache);
 	free(cache);
 
 	arm->core_cache = NULL;
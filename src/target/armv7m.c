@@ -804,7 +804,7 @@ struct reg_cache *armv7m_build_reg_cache(struct target *target)
 	struct arm *arm = &armv7m->arm;
 	int num_regs = ARMV7M_NUM_REGS;
 	struct reg_cache **cache_p = register_get_last_cache_p(&target->reg_cache);
-	struct reg_cache *cache = malloc(sizeof(struct reg_cache));
+	struct reg_cache *cache = calloc(1, sizeof(struct reg_cache));
 	struct reg *reg_list = calloc(num_regs, sizeof(struct reg));
 	struct arm_reg *arch_info = calloc(num_regs, sizeof(struct arm_reg));
 	struct reg_feature *feature;
@@ -887,6 +887,7 @@ void armv7m_free_reg_cache(struct target *target)
 
 	free(cache->reg_list[0].arch_info);
 	free(cache->reg_list);
+	register_cache_free_index(cache);
 	free(cache);
 
 	arm->core_cache = NULL;
@@ -933,15 +934,11 @@ int armv7m_checksum_memory(struct target *target,
 #include "../../contrib/loaders/checksum/armv7m_crc.inc"
 	};
 
-	retval = target_alloc_working_area(target, sizeof(cortex_m_crc_code), &crc_algorithm);
+	retval = target_alloc_algorithm_working_area(target, "armv7m_crc",
+			cortex_m_crc_code, sizeof(cortex_m_crc_code), &crc_algorithm);
 	if (retval != ERROR_OK)
 		return retval;
 
-	retval = target_write_buffer(target, crc_algorithm->address,
-			sizeof(cortex_m_crc_code), (uint8_t *)cortex_m_crc_code);
-	if (retval != ERROR_OK)
-		goto cleanup;
-
 	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
 	armv7m_info.core_mode = ARM_MODE_THREAD;
 
@@ -965,7 +962,6 @@ int armv7m_checksum_memory(struct target *target,
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
 
-cleanup:
 	target_free_working_area(target, crc_algorithm);
 
 	return retval;
@@ -990,14 +986,10 @@ int armv7m_blank_check_memory(struct target *target,
 	const uint32_t code_size = sizeof(erase_check_code);
 
 	/* make sure we have a working area */
-	if (target_alloc_working_area(target, code_size,
-		&erase_check_algorithm) != ERROR_OK)
-		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
-
-	retval = target_write_buffer(target, erase_check_algorithm->address,
-			code_size, erase_check_code);
+	retval = target_alloc_algorithm_working_area(target, "armv7m_erase_check",
+			erase_check_code, code_size, &erase_check_algorithm);
 	if (retval != ERROR_OK)
-		goto cleanup1;
+		return retval;
 
 	/* prepare blocks array for algo */
 	struct algo_block {
@@ -1820,8 +1820,8 @@ struct reg_cache *armv8_build_reg_cache(struct target *target)
 	int num_regs = ARMV8_NUM_REGS;
 	int num_regs32 = ARMV8_NUM_REGS32;
 	struct reg_cache **cache_p = register_get_last_cache_p(&target->reg_cache);
-	struct reg_cache *cache = malloc(sizeof(struct reg_cache));
-	struct reg_cache *cache32 = malloc(sizeof(struct reg_cache));
+	struct reg_cache *cache = calloc(1, sizeof(struct reg_cache));
+	struct reg_cache *cache32 = calloc(1, sizeof(struct reg_cache));
 	struct reg *reg_list = calloc(num_regs, sizeof(struct reg));
 	struct reg *reg_list32 = calloc(num_regs32, sizeof(struct reg));
 	struct arm_reg *arch_info = calloc(num_regs, sizeof(struct arm_reg));
@@ -1939,6 +1939,7 @@ static void armv8_free_cache(struct reg_cache *cache, bool regs32)
 	if (!regs32)
 		free(cache->reg_list[0].arch_info);
 	free(cache->reg_list);
+	register_cache_free_index(cache);
 	free(cache);
 }
 
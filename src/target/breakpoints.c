@@ -36,41 +36,185 @@ static const char * const watchpoint_rw_strings[] = {
 /* monotonic counter/id-number for breakpoints and watch points */
 static int bpwp_unique_id;
 
+/* The address index has 2^BPWP_INDEX_BITS buckets */
+#define BPWP_INDEX_BITS			8
+#define BPWP_INDEX_BUCKETS		(1u << BPWP_INDEX_BITS)
+
+/**
+ * Address index of the breakpoints and watchpoints of a target. The lists
+ * in struct target remain the ordered storage that the targets walk; the
+ * index is built from them on first use and kept up to date by this file.
+ * Bucket chains are in list order, so lookups return the same entry as a
+ * walk of the list would.
+ */
+struct bpwp_index {
+	struct breakpoint *breakpoints[BPWP_INDEX_BUCKETS];
+	struct watchpoint *watchpoints[BPWP_INDEX_BUCKETS];
+	/* next pointer of the last list entry, for appending */
+	struct breakpoint **breakpoint_tail;
+	struct watchpoint **watchpoint_tail;
+};
+
+static unsigned int bpwp_hash(target_addr_t address)
+{
+	uint64_t a = address;
+	/* instructions are at least 2-byte aligned */
+	uint32_t h = ((uint32_t)(a >> 32) ^ (uint32_t)a) >> 1;
+
+	return (h * 2654435761u) >> (32 - BPWP_INDEX_BITS);
+}
+
+static void breakpoint_index_insert(struct bpwp_index *index,
+		struct breakpoint *breakpoint)
+{
+	struct breakpoint **p = &index->breakpoints[bpwp_hash(breakpoint->address)];
+
+	while (*p)
+		p = &(*p)->hash_next;
+	breakpoint->hash_next = NULL;
+	*p = breakpoint;
+}
+
+static void breakpoint_index_remove(struct bpwp_index *index,
+		struct breakpoint *breakpoint)
+{
+	struct breakpoint **p = &index->breakpoints[bpwp_hash(breakpoint->address)];
+
+	while (*p && *p != breakpoint)
+		p = &(*p)->hash_next;
+	if (*p)
+		*p = breakpoint->hash_next;
+}
+
+static void watchpoint_index_insert(struct bpwp_index *index,
+		struct watchpoint *watchpoint)
+{
+	struct watchpoint **p = &index->watchpoints[bpwp_hash(watchpoint->address)];
+
+	while (*p)
+		p = &(*p)->hash_next;
+	watchpoint->hash_next = NULL;
+	*p = watchpoint;
+}
+
+static void watchpoint_index_remove(struct bpwp_index *index,
+		struct watchpoint *watchpoint)
+{
+	struct watchpoint **p = &index->watchpoints[bpwp_hash(watchpoint->address)];
+
+	while (*p && *p != watchpoint)
+		p = &(*p)->hash_next;
+	if (*p)
+		*p = watchpoint->hash_next;
+}
+
+static struct bpwp_index *bpwp_get_index(struct target *target)
+{
+	if (target->bpwp_index)
+		return target->bpwp_index;
+
+	struct bpwp_index *index = calloc(1, sizeof(*index));
+	if (!index) {
+		LOG_ERROR("Out of memory");
+		return NULL;
+	}
+
+	index->breakpoint_tail = &target->breakpoints;
+	for (struct breakpoint *b = target->breakpoints; b; b = b->next) {
+		breakpoint_index_insert(index, b);
+		index->breakpoint_tail = &b->next;
+	}
+
+	index->watchpoint_tail = &target->watchpoints;
+	for (struct watchpoint *w = target->watchpoints; w; w = w->next) {
+		watchpoint_index_insert(index, w);
+		index->watchpoint_tail = &w->next;
+	}
+
+	target->bpwp_index = index;
+	return index;
+}
+
+void breakpoint_free_index(struct target *target)
+{
+	free(target->bpwp_index);
+	target->bpwp_index = NULL;
+}
+
+static void breakpoint_append(struct bpwp_index *index, struct breakpoint *breakpoint)
+{
+	breakpoint->next = NULL;
+	*index->breakpoint_tail = breakpoint;
+	index->breakpoint_tail = &breakpoint->next;
+	breakpoint_index_insert(index, breakpoint);
+}
+
+/* Unlink a breakpoint, @a breakpoint_p points to the link to it. */
+static void breakpoint_unlink(struct bpwp_index *index,
+		struct breakpoint **breakpoint_p, struct breakpoint *breakpoint)
+{
+	*breakpoint_p = breakpoint->next;
+	if (index->breakpoint_tail == &breakpoint->next)
+		index->breakpoint_tail = breakpoint_p;
+	breakpoint_index_remove(index, breakpoint);
+}
+
+static void watchpoint_append(struct bpwp_index *index, struct watchpoint *watchpoint)
+{
+	watchpoint->next = NULL;
+	*index->watchpoint_tail = watchpoint;
+	index->watchpoint_tail = &watchpoint->next;
+	watchpoint_index_insert(index, watchpoint);
+}
+
+static void watchpoint_unlink(struct bpwp_index *index,
+		struct watchpoint **watchpoint_p, struct watchpoint *watchpoint)
+{
+	*watchpoint_p = watchpoint->next;
+	if (index->watchpoint_tail == &watchpoint->next)
+		index->watchpoint_tail = watchpoint_p;
+	watchpoint_index_remove(index, watchpoint);
+}
+
 static int breakpoint_add_internal(struct target *target,
 	target_addr_t address,
 	unsigned int length,
 	enum breakpoint_type type)
 {
-	struct breakpoint *breakpoint = target->breakpoints;
-	struct breakpoint **breakpoint_p = &target->breakpoints;
+	struct bpwp_index *index = bpwp_get_index(target);
+	struct breakpoint *breakpoint;
+	struct breakpoint **breakpoint_p;
 	const char *reason;
 	int retval;
 
-	while (breakpoint) {
-		if (breakpoint->address == address) {
-			/* FIXME don't assume "same address" means "same
-			 * breakpoint" ... check all the parameters before
-			 * succeeding.
-			 */
-			LOG_TARGET_ERROR(target, "Duplicate Breakpoint address: " TARGET_ADDR_FMT " (BP %" PRIu32 ")",
-				address, breakpoint->unique_id);
-			return ERROR_TARGET_DUPLICATE_BREAKPOINT;
-		}
-		breakpoint_p = &breakpoint->next;
-		breakpoint = breakpoint->next;
+	if (!index)
+		return ERROR_FAIL;
+
+	breakpoint = breakpoint_find(target, address);
+	if (breakpoint) {
+		/* FIXME don't assume "same address" means "same
+		 * breakpoint" ... check all the parameters before
+		 * succeeding.
+		 */
+		LOG_TARGET_ERROR(target, "Duplicate Breakpoint address: " TARGET_ADDR_FMT " (BP %" PRIu32 ")",
+			address, breakpoint->unique_id);
+		return ERROR_TARGET_DUPLICATE_BREAKPOINT;
 	}
 
-	(*breakpoint_p) = malloc(sizeof(struct breakpoint));
-	(*breakpoint_p)->address = address;
-	(*breakpoint_p)->asid = 0;
-	(*breakpoint_p)->length = length;
-	(*breakpoint_p)->type = type;
-	(*breakpoint_p)->is_set = false;
-	(*breakpoint_p)->orig_instr = malloc(length);
-	(*breakpoint_p)->next = NULL;
-	(*breakpoint_p)->unique_id = bpwp_unique_id++;
-
-	retval = target_add_breakpoint(target, *breakpoint_p);
+	breakpoint = malloc(sizeof(struct breakpoint));
+	breakpoint->address = address;
+	breakpoint->asid = 0;
+	breakpoint->length = length;
+	breakpoint->type = type;
+	breakpoint->is_set = false;
+	breakpoint->orig_instr = malloc(length);
+	breakpoint->unique_id = bpwp_unique_id++;
+	breakpoint_p = index->breakpoint_tail;
+	breakpoint_append(index, breakpoint);
+
+	/* The target writes the instruction and maintains its caches, so it is
+	 * up to the target to queue or batch those writes, as RISC-V does */
+	retval = target_add_breakpoint(target, breakpoint);
 	switch (retval) {
 	case ERROR_OK:
 		break;
@@ -84,17 +228,17 @@ static int breakpoint_add_internal(struct target *target,
 		reason = "unknown reason";
 fail:
 		LOG_TARGET_ERROR(target, "can't add breakpoint: %s", reason);
-		free((*breakpoint_p)->orig_instr);
-		free(*breakpoint_p);
-		*breakpoint_p = NULL;
+		breakpoint_unlink(index, breakpoint_p, breakpoint);
+		free(breakpoint->orig_instr);
+		free(breakpoint);
 		return retval;
 	}
 
 	LOG_TARGET_DEBUG(target, "added %s breakpoint at " TARGET_ADDR_FMT
 			" of length 0x%8.8x, (BPID: %" PRIu32 ")",
-		breakpoint_type_strings[(*breakpoint_p)->type],
-		(*breakpoint_p)->address, (*breakpoint_p)->length,
-		(*breakpoint_p)->unique_id);
+		breakpoint_type_strings[breakpoint->type],
+		breakpoint->address, breakpoint->length,
+		breakpoint->unique_id);
 
 	return ERROR_OK;
 }
@@ -104,10 +248,14 @@ static int context_breakpoint_add_internal(struct target *target,
 	unsigned int length,
 	enum breakpoint_type type)
 {
+	struct bpwp_index *index = bpwp_get_index(target);
 	struct breakpoint *breakpoint = target->breakpoints;
-	struct breakpoint **breakpoint_p = &target->breakpoints;
+	struct breakpoint **breakpoint_p;
 	int retval;
 
+	if (!index)
+		return ERROR_FAIL;
+
 	while (breakpoint) {
 		if (breakpoint->asid == asid) {
 			/* FIXME don't assume "same address" means "same
@@ -118,32 +266,33 @@ static int context_breakpoint_add_internal(struct target *target,
 				asid, breakpoint->unique_id);
 			return ERROR_TARGET_DUPLICATE_BREAKPOINT;
 		}
-		breakpoint_p = &breakpoint->next;
 		breakpoint = breakpoint->next;
 	}
 
-	(*breakpoint_p) = malloc(sizeof(struct breakpoint));
-	(*breakpoint_p)->address = 0;
-	(*breakpoint_p)->asid = asid;
-	(*breakpoint_p)->length = length;
-	(*breakpoint_p)->type = type;
-	(*breakpoint_p)->is_set = false;
-	(*breakpoint_p)->orig_instr = malloc(length);
-	(*breakpoint_p)->next = NULL;
-	(*breakpoint_p)->unique_id = bpwp_unique_id++;
-	retval = target_add_context_breakpoint(target, *breakpoint_p);
+	breakpoint = malloc(sizeof(struct breakpoint));
+	breakpoint->address = 0;
+	breakpoint->asid = asid;
+	breakpoint->length = length;
+	breakpoint->type = type;
+	breakpoint->is_set = false;
+	breakpoint->orig_instr = malloc(length);
+	breakpoint->unique_id = bpwp_unique_id++;
+	breakpoint_p = index->breakpoint_tail;
+	breakpoint_append(index, breakpoint);
+
+	retval = target_add_context_breakpoint(target, breakpoint);
 	if (retval != ERROR_OK) {
 		LOG_TARGET_ERROR(target, "could not add breakpoint");
-		free((*breakpoint_p)->orig_instr);
-		free(*breakpoint_p);
-		*breakpoint_p = NULL;
+		breakpoint_unlink(index, breakpoint_p, breakpoint);
+		free(breakpoint->orig_instr);
+		free(breakpoint);
 		return retval;
 	}
 
 	LOG_TARGET_DEBUG(target, "added %s Context breakpoint at 0x%8.8" PRIx32 " of length 0x%8.8x, (BPID: %" PRIu32 ")",
-		breakpoint_type_strings[(*breakpoint_p)->type],
-		(*breakpoint_p)->asid, (*breakpoint_p)->length,
-		(*breakpoint_p)->unique_id);
+		breakpoint_type_strings[breakpoint->type],
+		breakpoint->asid, breakpoint->length,
+		breakpoint->unique_id);
 
 	return ERROR_OK;
 }
@@ -154,10 +303,15 @@ static int hybrid_breakpoint_add_internal(struct target *target,
 	unsigned int length,
 	enum breakpoint_type type)
 {
-	struct breakpoint *breakpoint = target->breakpoints;
-	struct breakpoint **breakpoint_p = &target->breakpoints;
+	struct bpwp_index *index = bpwp_get_index(target);
+	struct breakpoint *breakpoint;
+	struct breakpoint **breakpoint_p;
 	int retval;
 
+	if (!index)
+		return ERROR_FAIL;
+
+	breakpoint = index->breakpoints[bpwp_hash(address)];
 	while (breakpoint) {
 		if ((breakpoint->asid == asid) && (breakpoint->address == address)) {
 			/* FIXME don't assume "same address" means "same
@@ -173,34 +327,34 @@ static int hybrid_breakpoint_add_internal(struct target *target,
 			return ERROR_TARGET_DUPLICATE_BREAKPOINT;
 
 		}
-		breakpoint_p = &breakpoint->next;
-		breakpoint = breakpoint->next;
+		breakpoint = breakpoint->hash_next;
 	}
-	(*breakpoint_p) = malloc(sizeof(struct breakpoint));
-	(*breakpoint_p)->address = address;
-	(*breakpoint_p)->asid = asid;
-	(*breakpoint_p)->length = length;
-	(*breakpoint_p)->type = type;
-	(*breakpoint_p)->is_set = false;
-	(*breakpoint_p)->orig_instr = malloc(length);
-	(*breakpoint_p)->next = NULL;
-	(*breakpoint_p)->unique_id = bpwp_unique_id++;
-
-
-	retval = target_add_hybrid_breakpoint(target, *breakpoint_p);
+	breakpoint = malloc(sizeof(struct breakpoint));
+	breakpoint->address = address;
+	breakpoint->asid = asid;
+	breakpoint->length = length;
+	breakpoint->type = type;
+	breakpoint->is_set = false;
+	breakpoint->orig_instr = malloc(length);
+	breakpoint->unique_id = bpwp_unique_id++;
+	breakpoint_p = index->breakpoint_tail;
+	breakpoint_append(index, breakpoint);
+
+
+	retval = target_add_hybrid_breakpoint(target, breakpoint);
 	if (retval != ERROR_OK) {
 		LOG_TARGET_ERROR(target, "could not add breakpoint");
-		free((*breakpoint_p)->orig_instr);
-		free(*breakpoint_p);
-		*breakpoint_p = NULL;
+		breakpoint_unlink(index, breakpoint_p, breakpoint);
+		free(breakpoint->orig_instr);
+		free(breakpoint);
 		return retval;
 	}
 	LOG_TARGET_DEBUG(target,
 		"added %s Hybrid breakpoint at address " TARGET_ADDR_FMT " of length 0x%8.8x, (BPID: %" PRIu32 ")",
-		breakpoint_type_strings[(*breakpoint_p)->type],
-		(*breakpoint_p)->address,
-		(*breakpoint_p)->length,
-		(*breakpoint_p)->unique_id);
+		breakpoint_type_strings[breakpoint->type],
+		breakpoint->address,
+		breakpoint->length,
+		breakpoint->unique_id);
 
 	return ERROR_OK;
 }
@@ -276,10 +430,14 @@ int hybrid_breakpoint_add(struct target *target,
 /* free up a breakpoint */
 static int breakpoint_free(struct target *target, struct breakpoint *breakpoint_to_remove)
 {
+	struct bpwp_index *index = bpwp_get_index(target);
 	struct breakpoint *breakpoint = target->breakpoints;
 	struct breakpoint **breakpoint_p = &target->breakpoints;
 	int retval;
 
+	if (!index)
+		return ERROR_FAIL;
+
 	while (breakpoint) {
 		if (breakpoint == breakpoint_to_remove)
 			break;
@@ -298,7 +456,7 @@ static int breakpoint_free(struct target *target, struct breakpoint *breakpoint_
 	}
 
 	LOG_TARGET_DEBUG(target, "free BPID: %" PRIu32 " --> %d", breakpoint->unique_id, retval);
-	(*breakpoint_p) = breakpoint->next;
+	breakpoint_unlink(index, breakpoint_p, breakpoint);
 	free(breakpoint->orig_instr);
 	free(breakpoint);
 
@@ -307,13 +465,20 @@ static int breakpoint_free(struct target *target, struct breakpoint *breakpoint_
 
 static int breakpoint_remove_internal(struct target *target, target_addr_t address)
 {
-	struct breakpoint *breakpoint = target->breakpoints;
+	struct bpwp_index *index = bpwp_get_index(target);
+	struct breakpoint *breakpoint = breakpoint_find(target, address);
 
-	while (breakpoint) {
-		if ((breakpoint->address == address) ||
-		    (breakpoint->address == 0 && breakpoint->asid == address))
+	if (!index)
+		return ERROR_FAIL;
+
+	/* A context breakpoint is removed by its ASID, take whichever of the
+	 * two matches was added first. */
+	for (struct breakpoint *b = index->breakpoints[bpwp_hash(0)]; b; b = b->hash_next) {
+		if (b->address == 0 && b->asid == address) {
+			if (!breakpoint || b->unique_id < breakpoint->unique_id)
+				breakpoint = b;
 			break;
-		breakpoint = breakpoint->next;
+		}
 	}
 
 	if (breakpoint) {
@@ -383,10 +548,14 @@ int breakpoint_remove(struct target *target, target_addr_t address)
 
 static int watchpoint_free(struct target *target, struct watchpoint *watchpoint_to_remove)
 {
+	struct bpwp_index *index = bpwp_get_index(target);
 	struct watchpoint *watchpoint = target->watchpoints;
 	struct watchpoint **watchpoint_p = &target->watchpoints;
 	int retval;
 
+	if (!index)
+		return ERROR_FAIL;
+
 	while (watchpoint) {
 		if (watchpoint == watchpoint_to_remove)
 			break;
@@ -404,7 +573,7 @@ static int watchpoint_free(struct target *target, struct watchpoint *watchpoint_
 	}
 
 	LOG_TARGET_DEBUG(target, "free WPID: %d --> %d", watchpoint->unique_id, retval);
-	(*watchpoint_p) = watchpoint->next;
+	watchpoint_unlink(index, watchpoint_p, watchpoint);
 	free(watchpoint);
 
 	return ERROR_OK;
@@ -469,12 +638,37 @@ int watchpoint_remove_all(struct target *target)
 
 struct breakpoint *breakpoint_find(struct target *target, target_addr_t address)
 {
-	struct breakpoint *breakpoint = target->breakpoints;
+	struct bpwp_index *index = bpwp_get_index(target);
+	struct breakpoint *breakpoint;
+
+	if (index)
+		breakpoint = index->breakpoints[bpwp_hash(address)];
+	else
+		breakpoint = target->breakpoints;
 
 	while (breakpoint) {
 		if (breakpoint->address == address)
 			return breakpoint;
-		breakpoint = breakpoint->next;
+		breakpoint = index ? breakpoint->hash_next : breakpoint->next;
+	}
+
+	return NULL;
+}
+
+struct watchpoint *watchpoint_find(struct target *target, target_addr_t address)
+{
+	struct bpwp_index *index = bpwp_get_index(target);
+	struct watchpoint *watchpoint;
+
+	if (index)
+		watchpoint = index->watchpoints[bpwp_hash(address)];
+	else
+		watchpoint = target->watchpoints;
+
+	while (watchpoint) {
+		if (watchpoint->address == address)
+			return watchpoint;
+		watchpoint = index ? watchpoint->hash_next : watchpoint->next;
 	}
 
 	return NULL;
@@ -483,39 +677,42 @@ struct breakpoint *breakpoint_find(struct target *target, target_addr_t address)
 static int watchpoint_add_internal(struct target *target, target_addr_t address,
 		unsigned int length, enum watchpoint_rw rw, uint64_t value, uint64_t mask)
 {
-	struct watchpoint *watchpoint = target->watchpoints;
-	struct watchpoint **watchpoint_p = &target->watchpoints;
+	struct bpwp_index *index = bpwp_get_index(target);
+	struct watchpoint *watchpoint;
+	struct watchpoint **watchpoint_p;
 	int retval;
 	const char *reason;
 
-	while (watchpoint) {
-		if (watchpoint->address == address) {
-			if (watchpoint->length != length
-				|| watchpoint->value != value
-				|| watchpoint->mask != mask
-				|| watchpoint->rw != rw) {
-				LOG_TARGET_ERROR(target, "address " TARGET_ADDR_FMT
-					" already has watchpoint %d",
-					address, watchpoint->unique_id);
-				return ERROR_FAIL;
-			}
+	if (!index)
+		return ERROR_FAIL;
 
-			/* ignore duplicate watchpoint */
-			return ERROR_OK;
+	watchpoint = watchpoint_find(target, address);
+	if (watchpoint) {
+		if (watchpoint->length != length
+			|| watchpoint->value != value
+			|| watchpoint->mask != mask
+			|| watchpoint->rw != rw) {
+			LOG_TARGET_ERROR(target, "address " TARGET_ADDR_FMT
+				" already has watchpoint %d",
+				address, watchpoint->unique_id);
+			return ERROR_FAIL;
 		}
-		watchpoint_p = &watchpoint->next;
-		watchpoint = watchpoint->next;
-	}
 
-	(*watchpoint_p) = calloc(1, sizeof(struct watchpoint));
-	(*watchpoint_p)->address = address;
-	(*watchpoint_p)->length = length;
-	(*watchpoint_p)->value = value;
-	(*watchpoint_p)->mask = mask;
-	(*watchpoint_p)->rw = rw;
-	(*watchpoint_p)->unique_id = bpwp_unique_id++;
+		/* ignore duplicate watchpoint */
+		return ERROR_OK;
+	}
 
-	retval = target_add_watchpoint(target, *watchpoint_p);
+	watchpoint = calloc(1, sizeof(struct watchpoint));
+	watchpoint->address = address;
+	watchpoint->length = length;
+	watchpoint->value = value;
+	watchpoint->mask = mask;
+	watchpoint->rw = rw;
+	watchpoint->unique_id = bpwp_unique_id++;
+	watchpoint_p = index->watchpoint_tail;
+	watchpoint_append(index, watchpoint);
+
+	retval = target_add_watchpoint(target, watchpoint);
 	switch (retval) {
 	case ERROR_OK:
 		break;
@@ -529,19 +726,19 @@ static int watchpoint_add_internal(struct target *target, target_addr_t address,
 		reason = "unrecognized error";
 bye:
 		LOG_TARGET_ERROR(target, "can't add %s watchpoint at " TARGET_ADDR_FMT ", %s",
-			watchpoint_rw_strings[(*watchpoint_p)->rw],
+			watchpoint_rw_strings[watchpoint->rw],
 			address, reason);
-		free(*watchpoint_p);
-		*watchpoint_p = NULL;
+		watchpoint_unlink(index, watchpoint_p, watchpoint);
+		free(watchpoint);
 		return retval;
 	}
 
 	LOG_TARGET_DEBUG(target, "added %s watchpoint at " TARGET_ADDR_FMT
 			" of length 0x%8.8x (WPID: %d)",
-		watchpoint_rw_strings[(*watchpoint_p)->rw],
-		(*watchpoint_p)->address,
-		(*watchpoint_p)->length,
-		(*watchpoint_p)->unique_id);
+		watchpoint_rw_strings[watchpoint->rw],
+		watchpoint->address,
+		watchpoint->length,
+		watchpoint->unique_id);
 
 	return ERROR_OK;
 }
@@ -568,13 +765,7 @@ int watchpoint_add(struct target *target, target_addr_t address,
 
 static int watchpoint_remove_internal(struct target *target, target_addr_t address)
 {
-	struct watchpoint *watchpoint = target->watchpoints;
-
-	while (watchpoint) {
-		if (watchpoint->address == address)
-			break;
-		watchpoint = watchpoint->next;
-	}
+	struct watchpoint *watchpoint = watchpoint_find(target, address);
 
 	if (watchpoint) {
 		return watchpoint_free(target, watchpoint);
@@ -32,6 +32,8 @@ struct breakpoint {
 	unsigned int number;
 	uint8_t *orig_instr;
 	struct breakpoint *next;
+	/* next breakpoint in the same bucket of the address index */
+	struct breakpoint *hash_next;
 	uint32_t unique_id;
 	int linked_brp;
 };
@@ -47,6 +49,8 @@ struct watchpoint {
 	bool is_set;
 	unsigned int number;
 	struct watchpoint *next;
+	/* next watchpoint in the same bucket of the address index */
+	struct watchpoint *hash_next;
 	int unique_id;
 };
 
@@ -61,6 +65,10 @@ int breakpoint_remove(struct target *target, target_addr_t address);
 int breakpoint_remove_all(struct target *target);
 
 struct breakpoint *breakpoint_find(struct target *target, target_addr_t address);
+struct watchpoint *watchpoint_find(struct target *target, target_addr_t address);
+
+/* Drop the address index, needed after editing the lists directly. */
+void breakpoint_free_index(struct target *target);
 
 static inline void breakpoint_hw_set(struct breakpoint *breakpoint, unsigned int hw_number)
 {
@@ -447,6 +447,167 @@ static int cortex_m_store_core_reg_u32(struct target *target,
 	return retval;
 }
 
+/**
+ * Write back the dirty core registers with one queued DCRDR/DCRSR sequence
+ * and check S_REGRDY only once at the end, like cortex_m_fast_read_all_regs()
+ * does for reads. Registers are left dirty if any transfer was not ready,
+ * armv7m_restore_context() then writes them again with polling.
+ */
+static int cortex_m_fast_write_dirty_regs(struct target *target)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct reg_cache *cache = armv7m->arm.core_cache;
+	const unsigned int n_r32 = ARMV7M_LAST_REG - ARMV7M_CORE_FIRST_REG + 1
+							   + ARMV7M_FPU_LAST_REG - ARMV7M_FPU_FIRST_REG + 1;
+	uint32_t dhcsr[n_r32];
+	unsigned int wi = 0; /* write index to dhcsr array */
+	unsigned int num_dirty = 0;
+	uint32_t dcrdr;
+	int retval;
+
+	if (cortex_m->slow_register_read)
+		return ERROR_OK;
+
+	/* Merge the dirty packed registers into their 32-bit containers first,
+	 * this way the containers are dirty before they are collected below. */
+	for (int i = cache->num_regs - 1; i >= 0; i--) {
+		struct reg *r = &cache->reg_list[i];
+		if (!r->exist || !r->dirty)
+			continue;
+
+		if (r->size <= 8) {
+			retval = armv7m->arm.write_core_reg(target, r, i, ARM_MODE_ANY, r->value);
+			if (retval != ERROR_OK)
+				return retval;
+		} else {
+			num_dirty++;
+		}
+	}
+
+	/* A single register costs the same either way. */
+	if (num_dirty < 2)
+		return ERROR_OK;
+
+	/* because the DCB_DCRDR is used for the emulated dcc channel
+	 * we have to save/restore the DCB_DCRDR when used */
+	bool dbg_msg_enabled = target->dbg_msg_enabled;
+	if (dbg_msg_enabled) {
+		retval = mem_ap_read_u32(armv7m->debug_ap, DCB_DCRDR, &dcrdr);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	for (int i = cache->num_regs - 1; i >= 0; i--) {
+		struct reg *r = &cache->reg_list[i];
+		if (!r->exist || !r->dirty)
+			continue;
+
+		assert(r->size == 32 || r->size == 64);
+		uint32_t regsel = armv7m_map_id_to_regsel(i);
+		for (unsigned int part = 0; part < r->size / 32; part++) {
+			/* the DHCSR read tells whether the transfer completed before
+			 * DCRDR is written again */
+			retval = mem_ap_write_u32(armv7m->debug_ap, DCB_DCRDR,
+					buf_get_u32(r->value + 4 * part, 0, 32));
+			if (retval == ERROR_OK)
+				retval = mem_ap_write_u32(armv7m->debug_ap, DCB_DCRSR,
+						(regsel + part) | DCRSR_WNR);
+			if (retval == ERROR_OK)
+				retval = mem_ap_read_u32(armv7m->debug_ap, DCB_DHCSR, &dhcsr[wi++]);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+	}
+
+	assert(wi <= n_r32);
+
+	retval = dap_run(armv7m->debug_ap->dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (dbg_msg_enabled) {
+		/* restore DCB_DCRDR - this needs to be in a separate
+		 * transaction otherwise the emulated DCC channel breaks */
+		retval = mem_ap_write_atomic_u32(armv7m->debug_ap, DCB_DCRDR, dcrdr);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	bool not_ready = false;
+	for (unsigned int i = 0; i < wi; i++) {
+		if ((dhcsr[i] & S_REGRDY) == 0)
+			not_ready = true;
+		cortex_m_cumulate_dhcsr_sticky(cortex_m, dhcsr[i]);
+	}
+
+	if (not_ready) {
+		/* Keep the registers dirty, they are written with S_REGRDY polling */
+		cortex_m->slow_register_read = true;
+		LOG_TARGET_DEBUG(target, "Register write was not ready, switched to slow register access");
+		return ERROR_OK;
+	}
+
+	LOG_TARGET_DEBUG(target, "wrote %u 32-bit registers", wi);
+
+	for (unsigned int i = 0; i < cache->num_regs; i++) {
+		struct reg *r = &cache->reg_list[i];
+		if (r->exist && r->dirty) {
+			r->valid = true;
+			r->dirty = false;
+		}
+	}
+
+	return ERROR_OK;
+}
+
+static int cortex_m_read_registers(struct target *target, struct reg **reg_list,
+		int reg_list_size)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct reg_cache *cache = cortex_m->armv7m.arm.core_cache;
+	bool need_read = false;
+
+	if (target->state != TARGET_HALTED || cortex_m->slow_register_read)
+		return ERROR_OK;
+
+	for (int i = 0; i < reg_list_size; i++) {
+		struct reg *r = reg_list[i];
+		if (r && r->exist && !r->valid && r >= cache->reg_list &&
+				r < cache->reg_list + cache->num_regs)
+			need_read = true;
+	}
+
+	/* The fast read refreshes every core register, do not lose the value
+	 * of a dirty one. */
+	for (unsigned int i = 0; i < cache->num_regs; i++) {
+		if (cache->reg_list[i].dirty)
+			need_read = false;
+	}
+
+	if (!need_read)
+		return ERROR_OK;
+
+	int retval = cortex_m_fast_read_all_regs(target);
+	if (retval == ERROR_TIMEOUT_REACHED) {
+		/* the caller reads the registers one by one */
+		cortex_m->slow_register_read = true;
+		LOG_TARGET_DEBUG(target, "Switched to slow register read");
+		return ERROR_OK;
+	}
+
+	return retval;
+}
+
+static int cortex_m_write_registers(struct target *target, struct reg **reg_list,
+		int reg_list_size)
+{
+	if (target->state != TARGET_HALTED)
+		return ERROR_OK;
+
+	return cortex_m_fast_write_dirty_regs(target);
+}
+
 static int cortex_m_write_debug_halt_mask(struct target *target,
 	uint32_t mask_on, uint32_t mask_off)
 {
@@ -1394,7 +1555,10 @@ static int cortex_m_restore_one(struct target *target, bool current,
 	if (current)
 		*address = resume_pc;
 
-	int retval = armv7m_restore_context(target);
+	/* armv7m_restore_context() writes whatever the fast path left dirty */
+	int retval = cortex_m_fast_write_dirty_regs(target);
+	if (retval == ERROR_OK)
+		retval = armv7m_restore_context(target);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -1542,6 +1706,8 @@ static int cortex_m_step(struct target *target, bool current,
 
 	target->debug_reason = DBG_REASON_SINGLESTEP;
 
+	/* armv7m_restore_context() writes whatever the fast path left dirty */
+	cortex_m_fast_write_dirty_regs(target);
 	armv7m_restore_context(target);
 
 	target_call_event_callbacks(target, TARGET_EVENT_RESUMED);
@@ -2408,6 +2574,35 @@ int cortex_m_profiling(struct target *target, uint32_t *samples,
 	return retval;
 }
 
+static int cortex_m_sample_pc(struct target *target, uint32_t *samples,
+		uint32_t max_num_samples, uint32_t *num_samples)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+
+	if (!armv7m->debug_ap)
+		return ERROR_NOT_IMPLEMENTED;
+
+	uint32_t read_count = MIN(max_num_samples, 1024);
+	int retval = mem_ap_read_buf_noincr(armv7m->debug_ap, (void *)samples,
+			4, read_count, DWT_PCSR);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* PCSR reads as zero if it is not implemented */
+	if (read_count && samples[0] == 0)
+		return ERROR_NOT_IMPLEMENTED;
+
+	/* and as all ones when no sample is available, e.g. in a sleep state */
+	uint32_t sample_count = 0;
+	for (uint32_t i = 0; i < read_count; i++) {
+		if (samples[i] != 0xffffffff)
+			samples[sample_count++] = samples[i];
+	}
+
+	*num_samples = sample_count;
+	return ERROR_OK;
+}
+
 
 /* REVISIT cache valid/dirty bits are unmaintained.  We could set "valid"
  * on r/w if the core is not running, and clear on resume or reset ... or
@@ -2592,6 +2787,7 @@ static void cortex_m_dwt_free(struct target *target)
 				free(cache->reg_list[i].arch_info);
 			free(cache->reg_list);
 		}
+		register_cache_free_index(cache);
 		free(cache);
 	}
 	cm->dwt_cache = NULL;
@@ -3433,6 +3629,8 @@ struct target_type cortexm_target = {
 
 	.get_gdb_arch = arm_get_gdb_arch,
 	.get_gdb_reg_list = armv7m_get_gdb_reg_list,
+	.read_registers = cortex_m_read_registers,
+	.write_registers = cortex_m_write_registers,
 
 	.read_memory = cortex_m_read_memory,
 	.write_memory = cortex_m_write_memory,
@@ -3457,4 +3655,5 @@ struct target_type cortexm_target = {
 	.deinit_target = cortex_m_deinit_target,
 
 	.profiling = cortex_m_profiling,
+	.sample_pc = cortex_m_sample_pc,
 };
@@ -1426,7 +1426,7 @@ static struct reg_cache *esirisc_build_reg_cache(struct target *target)
 {
 	struct esirisc_common *esirisc = target_to_esirisc(target);
 	struct reg_cache **cache_p = register_get_last_cache_p(&target->reg_cache);
-	struct reg_cache *cache = malloc(sizeof(struct reg_cache));
+	struct reg_cache *cache = calloc(1, sizeof(struct reg_cache));
 	struct reg *reg_list = calloc(ESIRISC_NUM_REGS, sizeof(struct reg));
 
 	LOG_TARGET_DEBUG(target, "-");
@@ -1509,6 +1509,7 @@ static void esirisc_free_reg_cache(struct target *target)
 	}
 
 	free(reg_list);
+	register_cache_free_index(cache);
 	free(cache);
 }
 
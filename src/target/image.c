@@ -1207,6 +1207,227 @@ int image_add_section(struct image *image, target_addr_t base, uint32_t size, ui
 	return ERROR_OK;
 }
 
+static int image_elf_read_table(struct image_elf *elf, uint64_t offset,
+		uint64_t size, uint8_t **buffer)
+{
+	size_t read_bytes;
+	int retval;
+
+	*buffer = NULL;
+
+	if (size == 0 || size > SIZE_MAX)
+		return ERROR_IMAGE_FORMAT_ERROR;
+
+	*buffer = malloc(size);
+	if (!*buffer) {
+		LOG_ERROR("insufficient memory to read ELF table");
+		return ERROR_FAIL;
+	}
+
+	retval = fileio_seek(elf->fileio, offset);
+	if (retval == ERROR_OK)
+		retval = fileio_read(elf->fileio, size, *buffer, &read_bytes);
+	if (retval == ERROR_OK && read_bytes != size)
+		retval = ERROR_IMAGE_FORMAT_ERROR;
+
+	if (retval != ERROR_OK) {
+		LOG_ERROR("cannot read ELF table");
+		free(*buffer);
+		*buffer = NULL;
+	}
+
+	return retval;
+}
+
+static int image_symbol_compare(const void *a, const void *b)
+{
+	const struct image_symbol *sa = a;
+	const struct image_symbol *sb = b;
+
+	if (sa->address < sb->address)
+		return -1;
+	return sa->address > sb->address;
+}
+
+int image_read_symbols(struct image *image, struct image_symbol **symbols,
+		unsigned int *num_symbols)
+{
+	struct image_elf *elf = image->type_private;
+	uint8_t *headers = NULL, *symtab = NULL, *strtab = NULL;
+	uint64_t symtab_size = 0, strtab_size = 0, sym_entsize;
+	unsigned int shnum, shentsize;
+	uint64_t shoff;
+	int retval;
+
+	*symbols = NULL;
+	*num_symbols = 0;
+
+	if (image->type != IMAGE_ELF) {
+		LOG_ERROR("symbols can only be read from ELF images");
+		return ERROR_IMAGE_FORMAT_ERROR;
+	}
+
+	if (elf->is_64_bit) {
+		shoff = field64(elf, elf->header64->e_shoff);
+		shnum = field16(elf, elf->header64->e_shnum);
+		shentsize = field16(elf, elf->header64->e_shentsize);
+		sym_entsize = sizeof(Elf64_Sym);
+		if (shentsize < sizeof(Elf64_Shdr))
+			shnum = 0;
+	} else {
+		shoff = field32(elf, elf->header32->e_shoff);
+		shnum = field16(elf, elf->header32->e_shnum);
+		shentsize = field16(elf, elf->header32->e_shentsize);
+		sym_entsize = sizeof(Elf32_Sym);
+		if (shentsize < sizeof(Elf32_Shdr))
+			shnum = 0;
+	}
+
+	if (shoff == 0 || shnum == 0) {
+		LOG_ERROR("ELF file has no section headers");
+		return ERROR_IMAGE_FORMAT_ERROR;
+	}
+
+	retval = image_elf_read_table(elf, shoff, (uint64_t)shnum * shentsize, &headers);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* find the symbol table and its string table */
+	for (unsigned int i = 0; i < shnum && !symtab; i++) {
+		uint64_t offset, size, str_offset = 0, str_size = 0;
+		unsigned int link;
+
+		if (elf->is_64_bit) {
+			Elf64_Shdr *shdr = (Elf64_Shdr *)(headers + i * shentsize);
+			if (field32(elf, shdr->sh_type) != SHT_SYMTAB)
+				continue;
+			offset = field64(elf, shdr->sh_offset);
+			size = field64(elf, shdr->sh_size);
+			link = field32(elf, shdr->sh_link);
+			if (link < shnum) {
+				Elf64_Shdr *str = (Elf64_Shdr *)(headers + link * shentsize);
+				str_offset = field64(elf, str->sh_offset);
+				str_size = field64(elf, str->sh_size);
+			}
+		} else {
+			Elf32_Shdr *shdr = (Elf32_Shdr *)(headers + i * shentsize);
+			if (field32(elf, shdr->sh_type) != SHT_SYMTAB)
+				continue;
+			offset = field32(elf, shdr->sh_offset);
+			size = field32(elf, shdr->sh_size);
+			link = field32(elf, shdr->sh_link);
+			if (link < shnum) {
+				Elf32_Shdr *str = (Elf32_Shdr *)(headers + link * shentsize);
+				str_offset = field32(elf, str->sh_offset);
+				str_size = field32(elf, str->sh_size);
+			}
+		}
+
+		retval = image_elf_read_table(elf, offset, size, &symtab);
+		if (retval == ERROR_OK)
+			retval = image_elf_read_table(elf, str_offset, str_size, &strtab);
+		if (retval != ERROR_OK)
+			goto done;
+		symtab_size = size;
+		strtab_size = str_size;
+	}
+
+	if (!symtab) {
+		LOG_ERROR("ELF file has no symbol table");
+		retval = ERROR_IMAGE_FORMAT_ERROR;
+		goto done;
+	}
+
+	uint64_t count = symtab_size / sym_entsize;
+	*symbols = calloc(count, sizeof(struct image_symbol));
+	if (!*symbols) {
+		LOG_ERROR("insufficient memory to read ELF symbols");
+		retval = ERROR_FAIL;
+		goto done;
+	}
+
+	/* keep defined function symbols only */
+	for (uint64_t i = 0; i < count; i++) {
+		struct image_symbol *symbol = &(*symbols)[*num_symbols];
+		uint32_t name;
+
+		if (elf->is_64_bit) {
+			Elf64_Sym *sym = (Elf64_Sym *)symtab + i;
+			if (ELF64_ST_TYPE(sym->st_info) != STT_FUNC ||
+					field16(elf, sym->st_shndx) == SHN_UNDEF)
+				continue;
+			name = field32(elf, sym->st_name);
+			symbol->address = field64(elf, sym->st_value);
+			symbol->size = field64(elf, sym->st_size);
+		} else {
+			Elf32_Sym *sym = (Elf32_Sym *)symtab + i;
+			if (ELF32_ST_TYPE(sym->st_info) != STT_FUNC ||
+					field16(elf, sym->st_shndx) == SHN_UNDEF)
+				continue;
+			name = field32(elf, sym->st_name);
+			symbol->address = field32(elf, sym->st_value);
+			symbol->size = field32(elf, sym->st_size);
+		}
+
+		if (name >= strtab_size)
+			continue;
+
+		symbol->name = strndup((char *)strtab + name, strtab_size - name);
+		if (!symbol->name) {
+			LOG_ERROR("insufficient memory to read ELF symbols");
+			image_free_symbols(*symbols, *num_symbols);
+			*symbols = NULL;
+			*num_symbols = 0;
+			retval = ERROR_FAIL;
+			goto done;
+		}
+		(*num_symbols)++;
+	}
+
+	qsort(*symbols, *num_symbols, sizeof(struct image_symbol), image_symbol_compare);
+	retval = ERROR_OK;
+
+done:
+	free(headers);
+	free(symtab);
+	free(strtab);
+	return retval;
+}
+
+void image_free_symbols(struct image_symbol *symbols, unsigned int num_symbols)
+{
+	if (!symbols)
+		return;
+
+	for (unsigned int i = 0; i < num_symbols; i++)
+		free(symbols[i].name);
+	free(symbols);
+}
+
+const struct image_symbol *image_find_symbol(const struct image_symbol *symbols,
+		unsigned int num_symbols, target_addr_t address)
+{
+	unsigned int low = 0, high = num_symbols;
+
+	/* find the last symbol starting at or below address */
+	while (low < high) {
+		unsigned int mid = low + (high - low) / 2;
+		if (symbols[mid].address <= address)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	if (low == 0)
+		return NULL;
+
+	const struct image_symbol *symbol = &symbols[low - 1];
+	if (symbol->size && address - symbol->address >= symbol->size)
+		return NULL;
+
+	return symbol;
+}
+
 void image_close(struct image *image)
 {
 	if (image->type == IMAGE_BINARY) {
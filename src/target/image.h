@@ -91,6 +91,13 @@ struct image_mot {
 	uint8_t *buffer;
 };
 
+/* function symbol of an ELF image */
+struct image_symbol {
+	target_addr_t address;
+	uint64_t size;
+	char *name;
+};
+
 int image_open(struct image *image, const char *url, const char *type_string);
 int image_read_section(struct image *image, int section, target_addr_t offset,
 		uint32_t size, uint8_t *buffer, size_t *size_read);
@@ -102,6 +109,12 @@ int image_add_section(struct image *image, target_addr_t base, uint32_t size,
 int image_calculate_checksum(const uint8_t *buffer, uint32_t nbytes,
 		uint32_t *checksum);
 
+int image_read_symbols(struct image *image, struct image_symbol **symbols,
+		unsigned int *num_symbols);
+void image_free_symbols(struct image_symbol *symbols, unsigned int num_symbols);
+const struct image_symbol *image_find_symbol(const struct image_symbol *symbols,
+		unsigned int num_symbols, target_addr_t address);
+
 #define ERROR_IMAGE_FORMAT_ERROR	(-1400)
 #define ERROR_IMAGE_TYPE_UNKNOWN	(-1401)
 #define ERROR_IMAGE_TEMPORARILY_UNAVAILABLE		(-1402)
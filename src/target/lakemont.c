@@ -364,7 +364,7 @@ struct reg_cache *lakemont_build_reg_cache(struct target *t)
 	struct x86_32_common *x86_32 = target_to_x86_32(t);
 	int num_regs = ARRAY_SIZE(regs);
 	struct reg_cache **cache_p = register_get_last_cache_p(&t->reg_cache);
-	struct reg_cache *cache = malloc(sizeof(struct reg_cache));
+	struct reg_cache *cache = calloc(1, sizeof(struct reg_cache));
 	struct reg *reg_list = calloc(num_regs, sizeof(struct reg));
 	struct lakemont_core_reg *arch_info = malloc(sizeof(struct lakemont_core_reg) * num_regs);
 	struct reg_feature *feature;
@@ -0,0 +1,428 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/log.h>
+#include <helper/time_support.h>
+
+#include "image.h"
+#include "profile.h"
+#include "target.h"
+
+/**
+ * @file
+ *
+ * Live profiling.
+ *
+ * Unlike the profile command, which collects all samples and writes them out
+ * at the end, live profiling keeps sampling the PC until it is stopped. The
+ * samples are folded into a fixed-size address histogram, so memory use does
+ * not grow with the run time, and the hottest functions are reported
+ * periodically.
+ */
+
+/* Number of histogram buckets, a power of two. */
+#define PROFILE_LIVE_BUCKETS		(64 * 1024)
+/* Keep the open-addressing table at most 3/4 full. */
+#define PROFILE_LIVE_MAX_USED		(PROFILE_LIVE_BUCKETS / 4 * 3)
+/* Maximum number of samples read per sampling run. */
+#define PROFILE_LIVE_CHUNK			4096
+/* Time between two sampling runs in milliseconds. */
+#define PROFILE_LIVE_PERIOD			10
+
+#define PROFILE_LIVE_LINE_SIZE		256
+
+struct profile_bucket {
+	uint32_t address;
+	/* 0 for an unused bucket */
+	uint32_t count;
+};
+
+struct profile_entry {
+	const char *name;
+	uint32_t address;
+	uint64_t count;
+};
+
+static struct {
+	struct target *target;
+	bool running;
+
+	struct profile_bucket *buckets;
+	unsigned int used;
+	/* total number of samples */
+	uint64_t total;
+	/* samples of new addresses that did not fit into the histogram */
+	uint64_t overflow;
+
+	uint32_t *samples;
+
+	struct image_symbol *symbols;
+	unsigned int num_symbols;
+
+	unsigned int top;
+	unsigned int report_ms;
+	int64_t next_report_ms;
+	FILE *output;
+} live;
+
+static void histogram_add(uint32_t address)
+{
+	unsigned int index = ((address >> 1) * 2654435761u) & (PROFILE_LIVE_BUCKETS - 1);
+
+	live.total++;
+
+	for (;;) {
+		struct profile_bucket *bucket = &live.buckets[index];
+
+		if (bucket->count && bucket->address == address) {
+			if (bucket->count < UINT32_MAX)
+				bucket->count++;
+			return;
+		}
+
+		if (!bucket->count) {
+			if (live.used >= PROFILE_LIVE_MAX_USED) {
+				live.overflow++;
+				return;
+			}
+			bucket->address = address;
+			bucket->count = 1;
+			live.used++;
+			return;
+		}
+
+		index = (index + 1) & (PROFILE_LIVE_BUCKETS - 1);
+	}
+}
+
+static int profile_entry_compare(const void *a, const void *b)
+{
+	const struct profile_entry *ea = a;
+	const struct profile_entry *eb = b;
+
+	if (ea->count > eb->count)
+		return -1;
+	return ea->count < eb->count;
+}
+
+/* Aggregate the histogram per function, or per address without symbols. */
+static int collect_entries(struct profile_entry **entries, unsigned int *num_entries)
+{
+	unsigned int count = 0;
+
+	*entries = NULL;
+	*num_entries = 0;
+
+	if (live.symbols) {
+		uint64_t *counts = calloc(live.num_symbols + 1, sizeof(uint64_t));
+		if (!counts)
+			return ERROR_FAIL;
+
+		for (unsigned int i = 0; i < PROFILE_LIVE_BUCKETS; i++) {
+			const struct profile_bucket *bucket = &live.buckets[i];
+			if (!bucket->count)
+				continue;
+
+			const struct image_symbol *symbol = image_find_symbol(live.symbols,
+					live.num_symbols, bucket->address);
+			/* the last slot collects samples outside of any function */
+			counts[symbol ? symbol - live.symbols : live.num_symbols] += bucket->count;
+		}
+
+		*entries = calloc(live.num_symbols + 1, sizeof(struct profile_entry));
+		if (!*entries) {
+			free(counts);
+			return ERROR_FAIL;
+		}
+
+		for (unsigned int i = 0; i <= live.num_symbols; i++) {
+			if (!counts[i])
+				continue;
+			(*entries)[count].name = i < live.num_symbols ? live.symbols[i].name : "<unknown>";
+			(*entries)[count].address = i < live.num_symbols ? live.symbols[i].address : 0;
+			(*entries)[count].count = counts[i];
+			count++;
+		}
+
+		free(counts);
+	} else {
+		*entries = calloc(live.used ? live.used : 1, sizeof(struct profile_entry));
+		if (!*entries)
+			return ERROR_FAIL;
+
+		for (unsigned int i = 0; i < PROFILE_LIVE_BUCKETS; i++) {
+			const struct profile_bucket *bucket = &live.buckets[i];
+			if (!bucket->count)
+				continue;
+			(*entries)[count].address = bucket->address;
+			(*entries)[count].count = bucket->count;
+			count++;
+		}
+	}
+
+	qsort(*entries, count, sizeof(struct profile_entry), profile_entry_compare);
+	*num_entries = count;
+
+	return ERROR_OK;
+}
+
+static void report_line(struct command_invocation *cmd, const char *line)
+{
+	if (cmd) {
+		command_print(cmd, "%s", line);
+		return;
+	}
+
+	LOG_INFO("%s", line);
+	if (live.output)
+		fprintf(live.output, "%s\n", line);
+}
+
+static int profile_live_report(struct command_invocation *cmd, unsigned int top)
+{
+	char line[PROFILE_LIVE_LINE_SIZE];
+	struct profile_entry *entries;
+	unsigned int num_entries;
+
+	int retval = collect_entries(&entries, &num_entries);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("profile: out of memory");
+		return retval;
+	}
+
+	snprintf(line, sizeof(line), "profile: %" PRIu64 " samples, %" PRIu64
+			" not binned, top %u:", live.total, live.overflow, MIN(top, num_entries));
+	report_line(cmd, line);
+
+	for (unsigned int i = 0; i < num_entries && i < top; i++) {
+		double percent = 100.0 * entries[i].count / live.total;
+
+		if (entries[i].name)
+			snprintf(line, sizeof(line), "%6.2f%% %10" PRIu64 "  %s", percent,
+					entries[i].count, entries[i].name);
+		else
+			snprintf(line, sizeof(line), "%6.2f%% %10" PRIu64 "  0x%08" PRIx32,
+					percent, entries[i].count, entries[i].address);
+		report_line(cmd, line);
+	}
+
+	if (!cmd && live.output)
+		fflush(live.output);
+
+	free(entries);
+	return ERROR_OK;
+}
+
+static void profile_live_free(void)
+{
+	free(live.buckets);
+	live.buckets = NULL;
+	free(live.samples);
+	live.samples = NULL;
+	image_free_symbols(live.symbols, live.num_symbols);
+	live.symbols = NULL;
+	live.num_symbols = 0;
+	if (live.output)
+		fclose(live.output);
+	live.output = NULL;
+	live.running = false;
+}
+
+static int profile_live_callback(void *priv)
+{
+	struct target *target = live.target;
+	uint32_t num_samples = 0;
+
+	/* Samples are only taken while the target runs; a halt is left alone
+	 * for whoever caused it. */
+	if (target->state != TARGET_RUNNING)
+		return ERROR_OK;
+
+	int retval = target_sample_pc(target, live.samples, PROFILE_LIVE_CHUNK,
+			&num_samples);
+	if (retval != ERROR_OK) {
+		LOG_TARGET_ERROR(target, "profile: sampling failed, live profiling stopped");
+		target_unregister_timer_callback(profile_live_callback, NULL);
+		profile_live_free();
+		return retval;
+	}
+
+	for (uint32_t i = 0; i < num_samples; i++)
+		histogram_add(live.samples[i]);
+
+	if (timeval_ms() >= live.next_report_ms) {
+		live.next_report_ms += live.report_ms;
+		return profile_live_report(NULL, live.top);
+	}
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_profile_live_start_command)
+{
+	unsigned int report_seconds;
+	unsigned int top;
+
+	if (CMD_ARGC < 2 || CMD_ARGC > 4)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (live.running) {
+		command_print(CMD, "live profiling is already running");
+		return ERROR_FAIL;
+	}
+
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], report_seconds);
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], top);
+
+	if (!report_seconds || !top)
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+
+	live.buckets = calloc(PROFILE_LIVE_BUCKETS, sizeof(struct profile_bucket));
+	live.samples = malloc(PROFILE_LIVE_CHUNK * sizeof(uint32_t));
+	if (!live.buckets || !live.samples) {
+		LOG_ERROR("No memory to store samples.");
+		profile_live_free();
+		return ERROR_FAIL;
+	}
+
+	if (CMD_ARGC >= 3) {
+		struct image image;
+
+		int retval = image_open(&image, CMD_ARGV[2], "elf");
+		if (retval == ERROR_OK) {
+			retval = image_read_symbols(&image, &live.symbols, &live.num_symbols);
+			image_close(&image);
+		}
+
+		if (retval != ERROR_OK) {
+			command_print(CMD, "failed to read symbols from %s", CMD_ARGV[2]);
+			profile_live_free();
+			return retval;
+		}
+	}
+
+	if (CMD_ARGC >= 4) {
+		live.output = fopen(CMD_ARGV[3], "a");
+		if (!live.output) {
+			command_print(CMD, "failed to open %s", CMD_ARGV[3]);
+			profile_live_free();
+			return ERROR_FAIL;
+		}
+	}
+
+	live.target = get_current_target(CMD_CTX);
+
+	/* Halting the target to read its PC would disturb a debugger, so only
+	 * targets that can sample it non-intrusively are supported. */
+	uint32_t num_samples;
+	int retval = target_sample_pc(live.target, live.samples, 1, &num_samples);
+	if (retval != ERROR_OK) {
+		if (retval == ERROR_NOT_IMPLEMENTED)
+			command_print(CMD, "target %s cannot sample its PC without halting",
+					target_name(live.target));
+		profile_live_free();
+		return retval == ERROR_NOT_IMPLEMENTED ? ERROR_FAIL : retval;
+	}
+
+	live.used = 0;
+	live.total = 0;
+	live.overflow = 0;
+	live.top = top;
+	live.report_ms = report_seconds * 1000;
+	live.next_report_ms = timeval_ms() + live.report_ms;
+
+	retval = target_register_timer_callback(profile_live_callback,
+			PROFILE_LIVE_PERIOD, TARGET_TIMER_TYPE_PERIODIC, NULL);
+	if (retval != ERROR_OK) {
+		profile_live_free();
+		return retval;
+	}
+
+	live.running = true;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_profile_live_stop_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!live.running)
+		return ERROR_OK;
+
+	target_unregister_timer_callback(profile_live_callback, NULL);
+	profile_live_free();
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_profile_live_report_command)
+{
+	unsigned int top;
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!live.running) {
+		command_print(CMD, "live profiling is not running");
+		return ERROR_FAIL;
+	}
+
+	top = live.top;
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], top);
+
+	return profile_live_report(CMD, top);
+}
+
+COMMAND_HANDLER(handle_profile_live_clear_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!live.running)
+		return ERROR_OK;
+
+	memset(live.buckets, 0, PROFILE_LIVE_BUCKETS * sizeof(struct profile_bucket));
+	live.used = 0;
+	live.total = 0;
+	live.overflow = 0;
+
+	return ERROR_OK;
+}
+
+const struct command_registration profile_live_command_handlers[] = {
+	{
+		.name = "start",
+		.handler = handle_profile_live_start_command,
+		.mode = COMMAND_EXEC,
+		.usage = "report_seconds top_n [elf_file [output_file]]",
+		.help = "start sampling the CPU PC until stopped",
+	},
+	{
+		.name = "stop",
+		.handler = handle_profile_live_stop_command,
+		.mode = COMMAND_EXEC,
+		.usage = "",
+		.help = "stop live profiling",
+	},
+	{
+		.name = "report",
+		.handler = handle_profile_live_report_command,
+		.mode = COMMAND_EXEC,
+		.usage = "[top_n]",
+		.help = "print the hottest functions or addresses so far",
+	},
+	{
+		.name = "clear",
+		.handler = handle_profile_live_clear_command,
+		.mode = COMMAND_EXEC,
+		.usage = "",
+		.help = "discard the samples collected so far",
+	},
+	COMMAND_REGISTRATION_DONE
+};
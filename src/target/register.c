@@ -25,18 +25,167 @@
  * may be separate registers associated with debug or trace modules.
  */
 
-struct reg *register_get_by_number(struct reg_cache *first,
-		uint32_t reg_num, bool search_all)
+/* Caches with fewer registers are searched linearly. */
+#define REG_CACHE_INDEX_MIN_REGS	32
+
+/* End of a chain in struct reg_cache_index */
+#define REG_CACHE_INDEX_END			UINT_MAX
+
+/**
+ * Hash index of a register cache by name and by number. The chains hold
+ * reg_list positions in ascending order, so that lookups return the same
+ * register as a linear search when several registers share a name or
+ * number.
+ */
+struct reg_cache_index {
+	/* reg_list and num_regs the index was built for */
+	const struct reg *reg_list;
+	unsigned int num_regs;
+	/* number of buckets, a power of two */
+	unsigned int num_buckets;
+	unsigned int *name_buckets;
+	unsigned int *number_buckets;
+	unsigned int *name_next;
+	unsigned int *number_next;
+};
+
+static unsigned int register_name_hash(const char *name)
 {
-	struct reg_cache *cache = first;
+	uint32_t hash = 2166136261u;
 
-	while (cache) {
+	while (*name) {
+		hash ^= (uint8_t)*name++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static unsigned int register_number_hash(uint32_t number)
+{
+	return number * 2654435761u;
+}
+
+static struct reg_cache_index *register_cache_get_index(struct reg_cache *cache)
+{
+	struct reg_cache_index *index = cache->index;
+
+	if (cache->num_regs < REG_CACHE_INDEX_MIN_REGS) {
+		register_cache_free_index(cache);
+		return NULL;
+	}
+
+	if (index && index->reg_list == cache->reg_list && index->num_regs == cache->num_regs)
+		return index;
+
+	register_cache_free_index(cache);
+
+	unsigned int num_buckets = 1;
+	while (num_buckets < 2 * cache->num_regs)
+		num_buckets <<= 1;
+
+	/* one allocation for the index and all its tables */
+	index = malloc(sizeof(*index) + (2 * num_buckets + 2 * cache->num_regs) * sizeof(unsigned int));
+	if (!index)
+		return NULL;
+
+	index->reg_list = cache->reg_list;
+	index->num_regs = cache->num_regs;
+	index->num_buckets = num_buckets;
+	index->name_buckets = (unsigned int *)(index + 1);
+	index->number_buckets = index->name_buckets + num_buckets;
+	index->name_next = index->number_buckets + num_buckets;
+	index->number_next = index->name_next + cache->num_regs;
+
+	for (unsigned int i = 0; i < num_buckets; i++) {
+		index->name_buckets[i] = REG_CACHE_INDEX_END;
+		index->number_buckets[i] = REG_CACHE_INDEX_END;
+	}
+
+	/* insert backwards, so that the chains are in ascending order */
+	for (unsigned int i = cache->num_regs; i-- > 0; ) {
+		const struct reg *reg = &cache->reg_list[i];
+		unsigned int bucket;
+
+		index->name_next[i] = REG_CACHE_INDEX_END;
+		if (reg->name) {
+			bucket = register_name_hash(reg->name) & (num_buckets - 1);
+			index->name_next[i] = index->name_buckets[bucket];
+			index->name_buckets[bucket] = i;
+		}
+
+		bucket = register_number_hash(reg->number) & (num_buckets - 1);
+		index->number_next[i] = index->number_buckets[bucket];
+		index->number_buckets[bucket] = i;
+	}
+
+	cache->index = index;
+	return index;
+}
+
+/** Drops the lookup index of a cache; call before freeing the cache. */
+void register_cache_free_index(struct reg_cache *cache)
+{
+	free(cache->index);
+	cache->index = NULL;
+}
+
+static struct reg *register_cache_get_by_number(struct reg_cache *cache, uint32_t reg_num)
+{
+	struct reg_cache_index *index = register_cache_get_index(cache);
+
+	if (!index) {
 		for (unsigned int i = 0; i < cache->num_regs; i++) {
 			if (!cache->reg_list[i].exist)
 				continue;
 			if (cache->reg_list[i].number == reg_num)
 				return &(cache->reg_list[i]);
 		}
+		return NULL;
+	}
+
+	unsigned int i = index->number_buckets[register_number_hash(reg_num) & (index->num_buckets - 1)];
+	for (; i != REG_CACHE_INDEX_END; i = index->number_next[i]) {
+		struct reg *reg = &cache->reg_list[i];
+		if (reg->exist && reg->number == reg_num)
+			return reg;
+	}
+
+	return NULL;
+}
+
+static struct reg *register_cache_get_by_name(struct reg_cache *cache, const char *name)
+{
+	struct reg_cache_index *index = register_cache_get_index(cache);
+
+	if (!index) {
+		for (unsigned int i = 0; i < cache->num_regs; i++) {
+			if (!cache->reg_list[i].exist)
+				continue;
+			if (strcmp(cache->reg_list[i].name, name) == 0)
+				return &cache->reg_list[i];
+		}
+		return NULL;
+	}
+
+	unsigned int i = index->name_buckets[register_name_hash(name) & (index->num_buckets - 1)];
+	for (; i != REG_CACHE_INDEX_END; i = index->name_next[i]) {
+		struct reg *reg = &cache->reg_list[i];
+		if (reg->exist && reg->name && strcmp(reg->name, name) == 0)
+			return reg;
+	}
+
+	return NULL;
+}
+
+struct reg *register_get_by_number(struct reg_cache *first,
+		uint32_t reg_num, bool search_all)
+{
+	struct reg_cache *cache = first;
+
+	while (cache) {
+		struct reg *reg = register_cache_get_by_number(cache, reg_num);
+		if (reg)
+			return reg;
 
 		if (!search_all)
 			break;
@@ -53,12 +202,9 @@ struct reg *register_get_by_name(struct reg_cache *first,
 	struct reg_cache *cache = first;
 
 	while (cache) {
-		for (unsigned int i = 0; i < cache->num_regs; i++) {
-			if (!cache->reg_list[i].exist)
-				continue;
-			if (strcmp(cache->reg_list[i].name, name) == 0)
-				return &(cache->reg_list[i]);
-		}
+		struct reg *reg = register_cache_get_by_name(cache, name);
+		if (reg)
+			return reg;
 
 		if (!search_all)
 			break;
@@ -90,7 +236,12 @@ void register_unlink_cache(struct reg_cache **cache_p, const struct reg_cache *c
 		*cache_p = cache->next;
 }
 
-/** Marks the contents of the register cache as invalid (and clean). */
+/**
+ * Marks the contents of the register cache as invalid (and clean).
+ * The lookup index is kept: lookups check reg->exist themselves, and an
+ * architecture that renames registers or replaces reg_list must drop the
+ * index with register_cache_free_index().
+ */
 void register_cache_invalidate(struct reg_cache *cache)
 {
 	for (unsigned int n = 0; n < cache->num_regs; n++) {
@@ -102,6 +253,32 @@ void register_cache_invalidate(struct reg_cache *cache)
 	}
 }
 
+/**
+ * Collects the registers of @a cache numbered from @a first to @a last whose
+ * cached value still has to be written to the target, in reg_list order.
+ * This lets an architecture write back all of them in one batch when the
+ * target is resumed, instead of one transaction per register write.
+ * @param regs receives the registers, with room for every register of the
+ * cache in that range
+ * @returns the number of registers stored in @a regs
+ */
+unsigned int register_cache_get_dirty(struct reg_cache *cache,
+		uint32_t first, uint32_t last, struct reg **regs)
+{
+	unsigned int count = 0;
+
+	for (unsigned int n = 0; n < cache->num_regs; n++) {
+		struct reg *reg = &cache->reg_list[n];
+		if (!reg->exist || !reg->valid || !reg->dirty)
+			continue;
+		if (reg->number < first || reg->number > last)
+			continue;
+		regs[count++] = reg;
+	}
+
+	return count;
+}
+
 static int register_get_dummy_core_reg(struct reg *reg)
 {
 	return ERROR_OK;
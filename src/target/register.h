@@ -141,11 +141,16 @@ struct reg {
 	const struct reg_arch_type *type;
 };
 
+struct reg_cache_index;
+
 struct reg_cache {
 	const char *name;
 	struct reg_cache *next;
 	struct reg *reg_list;
 	unsigned int num_regs;
+	/* Hash index by name and number, built on demand by the lookup
+	 * functions. Caches must be zero-initialized. */
+	struct reg_cache_index *index;
 };
 
 struct reg_arch_type {
@@ -160,6 +165,9 @@ struct reg *register_get_by_name(struct reg_cache *first,
 struct reg_cache **register_get_last_cache_p(struct reg_cache **first);
 void register_unlink_cache(struct reg_cache **cache_p, const struct reg_cache *cache);
 void register_cache_invalidate(struct reg_cache *cache);
+void register_cache_free_index(struct reg_cache *cache);
+unsigned int register_cache_get_dirty(struct reg_cache *cache,
+		uint32_t first, uint32_t last, struct reg **regs);
 
 void register_init_dummy(struct reg *reg);
 
@@ -9,6 +9,7 @@
 #include "debug_reg_printer.h"
 #include "riscv.h"
 #include "field_helpers.h"
+#include <helper/io_trace.h>
 
 // TODO: DTM_DMI_MAX_ADDRESS_LENGTH should be reduced to 32 (per the debug spec)
 #define DTM_DMI_MAX_ADDRESS_LENGTH	((1<<DTM_DTMCS_ABITS_LENGTH)-1)
@@ -275,6 +276,47 @@ static void log_batch(const struct riscv_batch *batch, size_t start_idx,
 	}
 }
 
+static void trace_batch(const struct riscv_batch *batch, size_t start_idx,
+		const struct riscv_scan_delays *delays, bool resets_delays,
+		size_t reset_delays_after)
+{
+	if (!io_trace_enabled())
+		return;
+
+	const unsigned int abits = riscv_get_dmi_address_bits(batch->target);
+	struct io_trace_dmi record = {
+		.dm_base = riscv_get_dmi_address(batch->target, 0),
+		.coreid = batch->target->coreid,
+		.abits = abits,
+	};
+
+	for (size_t i = start_idx; i < batch->used_scans; ++i) {
+		const struct scan_field * const field = &batch->fields[i];
+
+		record.op_out = buf_get_u32(field->out_value, DTM_DMI_OP_OFFSET,
+				DTM_DMI_OP_LENGTH);
+		record.data_out = buf_get_u32(field->out_value, DTM_DMI_DATA_OFFSET,
+				DTM_DMI_DATA_LENGTH);
+		record.address = buf_get_u32(field->out_value, DTM_DMI_ADDRESS_OFFSET,
+				abits);
+		if (field->in_value) {
+			record.op_in = buf_get_u32(field->in_value, DTM_DMI_OP_OFFSET,
+					DTM_DMI_OP_LENGTH);
+			record.data_in = buf_get_u32(field->in_value, DTM_DMI_DATA_OFFSET,
+					DTM_DMI_DATA_LENGTH);
+			record.address_in = buf_get_u32(field->in_value,
+					DTM_DMI_ADDRESS_OFFSET, abits);
+		} else {
+			record.op_in = 0xff;
+			record.data_in = 0;
+			record.address_in = 0;
+		}
+		record.idle = get_delay(batch, i, delays, resets_delays,
+				reset_delays_after);
+		io_trace_record(IO_TRACE_RISCV_DMI, &record, sizeof(record));
+	}
+}
+
 int riscv_batch_run_from(struct riscv_batch *batch, size_t start_idx,
 		const struct riscv_scan_delays *delays, bool resets_delays,
 		size_t reset_delays_after)
@@ -323,6 +365,7 @@ int riscv_batch_run_from(struct riscv_batch *batch, size_t start_idx,
 	}
 
 	log_batch(batch, start_idx, delays, resets_delays, reset_delays_after);
+	trace_batch(batch, start_idx, delays, resets_delays, reset_delays_after);
 	batch->was_run = true;
 	batch->last_scan_delay = delay;
 	return ERROR_OK;
@@ -1907,6 +1907,9 @@ static int handle_halt(struct target *target, bool announce)
 				return retval;
 	}
 
+	/* Memory may change behind our back before the next resume. */
+	riscv_info(target)->semihosting_call_site.valid = false;
+
 	if (announce)
 		target_call_event_callbacks(target, TARGET_EVENT_HALTED);
 
@@ -22,6 +22,7 @@
 #include "jtag/jtag.h"
 #include "target/register.h"
 #include "target/breakpoints.h"
+#include "target/smp.h"
 #include "helper/time_support.h"
 #include "helper/list.h"
 #include "riscv.h"
@@ -60,6 +61,8 @@ static void riscv013_fill_dmi_read(const struct target *target, uint8_t *buf, ui
 static unsigned int riscv013_get_dmi_address_bits(const struct target *target);
 static void riscv013_fill_dm_nop(const struct target *target, uint8_t *buf);
 static unsigned int register_size(struct target *target, enum gdb_regno number);
+static int riscv013_read_gprs(struct target *target, struct reg **reg_list,
+		int reg_list_size);
 static int register_read_direct(struct target *target, riscv_reg_t *value,
 		enum gdb_regno number);
 static int register_write_direct(struct target *target, enum gdb_regno number,
@@ -2775,6 +2778,123 @@ static int sample_memory(struct target *target,
 	return sample_memory_bus_v1(target, buf, config, until_ms);
 }
 
+/* Number of PC samples collected by a single batch. */
+#define SAMPLE_PC_BATCH_SIZE	1024
+
+static int sample_pc(struct target *target, target_addr_t address,
+		uint32_t size_bytes, uint32_t *samples, uint32_t max_num_samples,
+		uint32_t *num_samples, int64_t until_ms)
+{
+	RISCV013_INFO(info);
+	unsigned int sbasize = get_field(info->sbcs, DM_SBCS_SBASIZE);
+
+	*num_samples = 0;
+
+	if (sbasize == 0 || sbasize > 64) {
+		LOG_TARGET_ERROR(target, "PC sampling is only implemented for non-zero sbasize <= 64.");
+		return ERROR_NOT_IMPLEMENTED;
+	}
+
+	if (get_field(info->sbcs, DM_SBCS_SBVERSION) != 1) {
+		LOG_TARGET_ERROR(target, "PC sampling is only implemented for SBA version 1.");
+		return ERROR_NOT_IMPLEMENTED;
+	}
+
+	if (!sba_supports_access(target, size_bytes)) {
+		LOG_TARGET_ERROR(target, "Hardware does not support SBA access for %" PRIu32 "-byte PC sampling.",
+				size_bytes);
+		return ERROR_NOT_IMPLEMENTED;
+	}
+
+	/*
+	 * With sbreadondata set, every read of sbdata0 returns the current sample
+	 * and starts the next system bus read, so a batch is little more than a
+	 * long run of sbdata0 reads.
+	 */
+	const uint32_t sbcs_write = DM_SBCS_SBREADONADDR | DM_SBCS_SBREADONDATA |
+		sb_sbaccess(size_bytes);
+	const unsigned int reads_per_sample = size_bytes > 4 ? 2 : 1;
+
+	/* Always run at least one batch, even if until_ms has already passed. */
+	do {
+		const unsigned int count = MIN(SAMPLE_PC_BATCH_SIZE,
+				max_num_samples - *num_samples);
+		struct riscv_batch *batch = riscv_batch_alloc(target,
+				4 + count * reads_per_sample);
+		if (!batch)
+			return ERROR_FAIL;
+
+		/* Restart the read chain in every batch, so that a discarded batch
+		 * leaves nothing behind. */
+		riscv_batch_add_dm_write(batch, DM_SBCS, sbcs_write, true,
+				RISCV_DELAY_BASE);
+		if (sbasize > 32)
+			riscv_batch_add_dm_write(batch, DM_SBADDRESS1, address >> 32,
+					true, RISCV_DELAY_BASE);
+		riscv_batch_add_dm_write(batch, DM_SBADDRESS0, (uint32_t)address,
+				true, RISCV_DELAY_SYSBUS_READ);
+
+		for (unsigned int i = 0; i < count; i++) {
+			if (size_bytes > 4)
+				riscv_batch_add_dm_read(batch, DM_SBDATA1,
+						RISCV_DELAY_BASE);
+			riscv_batch_add_dm_read(batch, DM_SBDATA0,
+					RISCV_DELAY_SYSBUS_READ);
+		}
+
+		size_t sbcs_read_index = riscv_batch_add_dm_read(batch, DM_SBCS,
+				RISCV_DELAY_BASE);
+
+		int result = batch_run(target, batch);
+		if (result != ERROR_OK) {
+			riscv_batch_free(batch);
+			return result;
+		}
+
+		/* Discard the batch on a busy DMI, same as sample_memory_bus_v1(). */
+		const uint32_t sbcs_read_op = riscv_batch_get_dmi_read_op(batch, sbcs_read_index);
+		if (sbcs_read_op == DTM_DMI_OP_BUSY) {
+			riscv_batch_free(batch);
+			result = increase_dmi_busy_delay(target);
+			if (result != ERROR_OK)
+				return result;
+			continue;
+		}
+
+		uint32_t sbcs_read = riscv_batch_get_dmi_read_data(batch, sbcs_read_index);
+		if (get_field(sbcs_read, DM_SBCS_SBBUSYERROR)) {
+			dm_write(target, DM_SBCS, sbcs_read | DM_SBCS_SBBUSYERROR | DM_SBCS_SBERROR);
+			riscv_batch_free(batch);
+			result = riscv_scan_increase_delay(&info->learned_delays,
+					RISCV_DELAY_SYSBUS_READ);
+			if (result != ERROR_OK)
+				return result;
+			continue;
+		}
+		if (get_field(sbcs_read, DM_SBCS_SBERROR)) {
+			LOG_TARGET_ERROR(target, "System bus error while sampling PC at 0x%" TARGET_PRIxADDR ".",
+					address);
+			dm_write(target, DM_SBCS, DM_SBCS_SBBUSYERROR | DM_SBCS_SBERROR);
+			riscv_batch_free(batch);
+			return ERROR_FAIL;
+		}
+
+		unsigned int read_count = 0;
+		for (unsigned int i = 0; i < count; i++) {
+			/* Upper bits of a 64-bit PC are dropped, gmon output is 32-bit. */
+			if (size_bytes > 4)
+				read_count++;
+			samples[(*num_samples)++] =
+				riscv_batch_get_dmi_read_data(batch, read_count++);
+		}
+
+		riscv_batch_free(batch);
+	} while (*num_samples < max_num_samples && timeval_ms() < until_ms);
+
+	/* Leave the system bus idle. */
+	return dm_write(target, DM_SBCS, 0);
+}
+
 static int riscv013_get_hart_state(struct target *target, enum riscv_hart_state *state)
 {
 	RISCV013_INFO(info);
@@ -2826,6 +2946,87 @@ static int riscv013_get_hart_state(struct target *target, enum riscv_hart_state
 	return ERROR_FAIL;
 }
 
+static int riscv013_get_group_state(struct target *target,
+		struct list_head *targets, bool *uniform, enum riscv_hart_state *state)
+{
+	dm013_info_t *dm = get_dm(target);
+	if (!dm)
+		return ERROR_FAIL;
+	if (!dm->hasel_supported)
+		return ERROR_NOT_IMPLEMENTED;
+
+	assert(dm->hart_count);
+	const unsigned int hawindow_count = DIV_ROUND_UP(dm->hart_count, 32);
+	uint32_t *hawindow = calloc(hawindow_count, sizeof(uint32_t));
+	if (!hawindow)
+		return ERROR_FAIL;
+
+	/* With hasel set, hartsel still selects hart 0 as well, see
+	 * set_dmcontrol_hartsel(). That hart has to be one of the group. */
+	bool hart0_selected = false;
+	unsigned int count = 0;
+	struct target_list *entry;
+	foreach_smp_target(entry, targets) {
+		struct target *t = entry->target;
+		if (!target_was_examined(t) || get_dm(t) != dm) {
+			free(hawindow);
+			return ERROR_NOT_IMPLEMENTED;
+		}
+		const unsigned int index = get_info(t)->index;
+		hawindow[index / 32] |= 1u << (index % 32);
+		hart0_selected |= index == 0;
+		count++;
+	}
+	if (count < 2 || !hart0_selected) {
+		free(hawindow);
+		return ERROR_NOT_IMPLEMENTED;
+	}
+
+	if (dm013_select_hart(target, HART_INDEX_MULTIPLE) != ERROR_OK) {
+		free(hawindow);
+		return ERROR_FAIL;
+	}
+
+	struct riscv_batch *batch = riscv_batch_alloc(target, 2 * hawindow_count + 1);
+	if (!batch) {
+		free(hawindow);
+		return ERROR_FAIL;
+	}
+	for (unsigned int i = 0; i < hawindow_count; i++) {
+		riscv_batch_add_dm_write(batch, DM_HAWINDOWSEL, i, /* read_back */ true,
+				RISCV_DELAY_BASE);
+		riscv_batch_add_dm_write(batch, DM_HAWINDOW, hawindow[i], /* read_back */ true,
+				RISCV_DELAY_BASE);
+	}
+	const size_t dmstatus_key = riscv_batch_add_dm_read(batch, DM_DMSTATUS,
+			RISCV_DELAY_BASE);
+	free(hawindow);
+
+	int result = batch_run_timeout(target, batch);
+	if (result != ERROR_OK) {
+		riscv_batch_free(batch);
+		return result;
+	}
+	const uint32_t dmstatus = riscv_batch_get_dmi_read_data(batch, dmstatus_key);
+	riscv_batch_free(batch);
+	LOG_DEBUG_REG(target, DM_DMSTATUS, dmstatus);
+
+	*uniform = false;
+	if (get_field(dmstatus, DM_DMSTATUS_ANYHAVERESET) ||
+			get_field(dmstatus, DM_DMSTATUS_ANYNONEXISTENT) ||
+			get_field(dmstatus, DM_DMSTATUS_ANYUNAVAIL))
+		return ERROR_OK;
+
+	if (get_field(dmstatus, DM_DMSTATUS_ALLHALTED)) {
+		*uniform = true;
+		*state = RISCV_STATE_HALTED;
+	} else if (get_field(dmstatus, DM_DMSTATUS_ALLRUNNING)) {
+		*uniform = true;
+		*state = RISCV_STATE_RUNNING;
+	}
+	return ERROR_OK;
+}
+
 static int handle_became_unavailable(struct target *target,
 		enum riscv_hart_state previous_riscv_state)
 {
@@ -2859,6 +3060,7 @@ static int init_target(struct command_context *cmd_ctx,
 
 	generic_info->select_target = &dm013_select_target;
 	generic_info->get_hart_state = &riscv013_get_hart_state;
+	generic_info->get_group_state = &riscv013_get_group_state;
 	generic_info->resume_go = &riscv013_resume_go;
 	generic_info->step_current_hart = &riscv013_step_current_hart;
 	generic_info->resume_prep = &riscv013_resume_prep;
@@ -2880,6 +3082,7 @@ static int init_target(struct command_context *cmd_ctx,
 	generic_info->dmi_write = &dmi_write;
 	generic_info->get_dmi_address = &riscv013_get_dmi_address;
 	generic_info->access_memory = &riscv013_access_memory;
+	generic_info->read_registers = &riscv013_read_gprs;
 	generic_info->data_bits = &riscv013_data_bits;
 	generic_info->print_info = &riscv013_print_info;
 	generic_info->get_impebreak = &riscv013_get_impebreak;
@@ -2894,6 +3097,7 @@ static int init_target(struct command_context *cmd_ctx,
 			return ERROR_FAIL;
 	}
 	generic_info->sample_memory = sample_memory;
+	generic_info->sample_pc = sample_pc;
 	riscv013_info_t *info = get_info(target);
 
 	info->progbufsize = -1;
@@ -5148,6 +5352,191 @@ int riscv013_set_register(struct target *target, enum gdb_regno rid,
 	return register_write_direct(target, rid, value);
 }
 
+/**
+ * Write back the dirty GPRs with abstract commands queued in a single batch,
+ * instead of running one batch per register. The abstract command status is
+ * read after each command; since cmderr is sticky, a register is known to be
+ * written when that status shows neither busy nor an error. The remaining
+ * registers are left dirty, so that the caller writes them one by one.
+ */
+int riscv013_flush_dirty_gprs(struct target *target)
+{
+	struct reg *regs[GDB_REGNO_XPR31 + 1];
+	uint32_t commands[GDB_REGNO_XPR31 + 1];
+	size_t abstractcs_read_keys[GDB_REGNO_XPR31 + 1];
+
+	if (!target->reg_cache)
+		return ERROR_OK;
+
+	const unsigned int count = register_cache_get_dirty(target->reg_cache,
+			GDB_REGNO_RA, GDB_REGNO_XPR31, regs);
+	/* A single register costs the same either way. */
+	if (count < 2)
+		return ERROR_OK;
+
+	dm013_info_t *dm = get_dm(target);
+	if (!dm)
+		return ERROR_FAIL;
+
+	if (dm013_select_target(target) != ERROR_OK)
+		return ERROR_FAIL;
+
+	const unsigned int size_bits = register_size(target, GDB_REGNO_ZERO);
+	for (unsigned int i = 0; i < count; i++) {
+		commands[i] = riscv013_access_register_command(target, regs[i]->number,
+				size_bits, AC_ACCESS_REGISTER_TRANSFER | AC_ACCESS_REGISTER_WRITE);
+		if (is_command_unsupported(target, commands[i]))
+			return ERROR_OK;
+	}
+
+	LOG_TARGET_DEBUG(target, "Writing back %u GPRs in one batch", count);
+
+	struct riscv_batch * const batch = riscv_batch_alloc(target,
+			count * (size_bits / 32 + ABSTRACT_COMMAND_BATCH_SIZE));
+	if (!batch)
+		return ERROR_FAIL;
+
+	for (unsigned int i = 0; i < count; i++) {
+		abstract_data_write_fill_batch(batch,
+				buf_get_u64(regs[i]->value, 0, size_bits), /*index*/ 0, size_bits);
+		abstractcs_read_keys[i] = abstract_cmd_fill_batch(batch, commands[i]);
+	}
+	/* Abstract commands are executed while running the batch. */
+	dm->abstract_cmd_maybe_busy = true;
+
+	int res = batch_run_timeout(target, batch);
+	if (res != ERROR_OK)
+		goto cleanup;
+
+	unsigned int written = 0;
+	for (; written < count; written++) {
+		const uint32_t abstractcs = riscv_batch_get_dmi_read_data(batch,
+				abstractcs_read_keys[written]);
+		if (get_field32(abstractcs, DM_ABSTRACTCS_BUSY) ||
+				get_field32(abstractcs, DM_ABSTRACTCS_CMDERR))
+			break;
+		regs[written]->dirty = false;
+	}
+
+	if (written < count) {
+		LOG_TARGET_DEBUG(target, "Batched write of %s failed, writing the "
+				"remaining GPRs one by one", regs[written]->name);
+		/* Wait for the command to finish, adjust the delay and clear cmderr. */
+		uint32_t cmderr;
+		if (abstract_cmd_batch_check_and_clear_cmderr(target, batch,
+					abstractcs_read_keys[written], &cmderr) != ERROR_OK &&
+				cmderr == CMDERR_NOT_SUPPORTED)
+			mark_command_as_unsupported(target, commands[written]);
+	} else {
+		dm->abstract_cmd_maybe_busy = false;
+	}
+
+cleanup:
+	riscv_batch_free(batch);
+	return res;
+}
+
+/**
+ * Read the GPRs of @a reg_list that are not cached yet with abstract commands
+ * queued in a single batch, e.g. to answer the GDB 'g' packet. As when writing
+ * them back, the status is read after each command and the registers that
+ * are not confirmed are left invalid for the caller to read one by one.
+ */
+static int riscv013_read_gprs(struct target *target, struct reg **reg_list,
+		int reg_list_size)
+{
+	struct reg *regs[GDB_REGNO_XPR31 + 1];
+	uint32_t commands[GDB_REGNO_XPR31 + 1];
+	size_t abstractcs_read_keys[GDB_REGNO_XPR31 + 1];
+	unsigned int count = 0;
+
+	if (!target->reg_cache || target->state != TARGET_HALTED)
+		return ERROR_OK;
+
+	const unsigned int size_bits = register_size(target, GDB_REGNO_ZERO);
+	for (int i = 0; i < reg_list_size && count < ARRAY_SIZE(regs); i++) {
+		struct reg *reg = reg_list[i];
+		if (!reg || !reg->exist || reg->valid)
+			continue;
+		if (reg->number < GDB_REGNO_RA || reg->number > GDB_REGNO_XPR31)
+			continue;
+		if (reg != &target->reg_cache->reg_list[reg->number])
+			continue;
+
+		commands[count] = riscv013_access_register_command(target, reg->number,
+				size_bits, AC_ACCESS_REGISTER_TRANSFER);
+		if (is_command_unsupported(target, commands[count]))
+			return ERROR_OK;
+		regs[count++] = reg;
+	}
+	/* A single register costs the same either way. */
+	if (count < 2)
+		return ERROR_OK;
+
+	dm013_info_t *dm = get_dm(target);
+	if (!dm)
+		return ERROR_FAIL;
+
+	if (dm013_select_target(target) != ERROR_OK)
+		return ERROR_FAIL;
+
+	LOG_TARGET_DEBUG(target, "Reading %u GPRs in one batch", count);
+
+	const unsigned int size_in_words = size_bits / 32;
+	struct riscv_batch * const batch = riscv_batch_alloc(target,
+			count * (size_in_words + ABSTRACT_COMMAND_BATCH_SIZE));
+	if (!batch)
+		return ERROR_FAIL;
+
+	for (unsigned int i = 0; i < count; i++) {
+		abstractcs_read_keys[i] = abstract_cmd_fill_batch(batch, commands[i]);
+		/* The data keys directly follow the abstractcs key. */
+		abstract_data_read_fill_batch(batch, /*index*/ 0, size_bits);
+	}
+	/* Abstract commands are executed while running the batch. */
+	dm->abstract_cmd_maybe_busy = true;
+
+	int res = batch_run_timeout(target, batch);
+	if (res != ERROR_OK)
+		goto cleanup;
+
+	unsigned int read = 0;
+	for (; read < count; read++) {
+		const size_t key = abstractcs_read_keys[read];
+		const uint32_t abstractcs = riscv_batch_get_dmi_read_data(batch, key);
+		if (get_field32(abstractcs, DM_ABSTRACTCS_BUSY) ||
+				get_field32(abstractcs, DM_ABSTRACTCS_CMDERR))
+			break;
+
+		riscv_reg_t value = 0;
+		for (unsigned int w = 0; w < size_in_words; w++)
+			value |= (riscv_reg_t)riscv_batch_get_dmi_read_data(batch,
+					key + 1 + w) << (32 * w);
+
+		buf_set_u64(regs[read]->value, 0, regs[read]->size, value);
+		regs[read]->valid = true;
+		regs[read]->dirty = false;
+		LOG_TARGET_DEBUG(target, "Read %s: 0x%" PRIx64, regs[read]->name, value);
+	}
+
+	if (read < count) {
+		LOG_TARGET_DEBUG(target, "Batched read of %s failed, reading the "
+				"remaining GPRs one by one", regs[read]->name);
+		/* Wait for the command to finish, adjust the delay and clear cmderr. */
+		uint32_t cmderr;
+		if (abstract_cmd_batch_check_and_clear_cmderr(target, batch,
+					abstractcs_read_keys[read], &cmderr) != ERROR_OK &&
+				cmderr == CMDERR_NOT_SUPPORTED)
+			mark_command_as_unsupported(target, commands[read]);
+	} else {
+		dm->abstract_cmd_maybe_busy = false;
+	}
+
+cleanup:
+	riscv_batch_free(batch);
+	return res;
+}
+
 static int dm013_select_hart(struct target *target, int hart_index)
 {
 	dm013_info_t *dm = get_dm(target);
@@ -315,6 +315,7 @@ static void riscv_sample_buf_maybe_add_timestamp(struct target *target, bool bef
 }
 
 static int riscv_resume_go_all_harts(struct target *target);
+static int sw_breakpoints_flush_target(struct target *target);
 
 void select_dmi_via_bscan(struct jtag_tap *tap)
 {
@@ -727,6 +728,9 @@ static void riscv_deinit_target(struct target *target)
 	if (riscv_reg_flush_all(target) != ERROR_OK)
 		LOG_TARGET_ERROR(target, "Failed to flush registers. Ignoring this error.");
 
+	if (info && sw_breakpoints_flush_target(target) != ERROR_OK)
+		LOG_TARGET_ERROR(target, "Failed to write software breakpoints. Ignoring this error.");
+
 	if (tt && info && info->version_specific)
 		tt->deinit_target(target);
 
@@ -737,6 +741,7 @@ static void riscv_deinit_target(struct target *target)
 		return;
 
 	free(info->reserved_triggers);
+	free(info->sw_breakpoint_ops);
 
 	range_list_t *entry, *tmp;
 	list_for_each_entry_safe(entry, tmp, &info->hide_csr, list) {
@@ -1604,6 +1609,180 @@ int riscv_read_by_any_size(struct target *target, target_addr_t address, uint32_
 	return ERROR_FAIL;
 }
 
+/*
+ * Software breakpoint instructions are not written to memory when the
+ * breakpoints are added or removed on a halted hart; on a running hart they
+ * are written right away. gdb removes all its breakpoints whenever
+ * the target halts and inserts them again before it resumes, so a removal is
+ * usually cancelled by the insert that follows and never reaches the target.
+ * The remaining writes are done by riscv_flush_sw_breakpoints(), in the order
+ * they were requested, before a hart runs or the affected memory is written.
+ * Reads see the memory as if every write had already been done.
+ */
+struct riscv_sw_breakpoint_op {
+	target_addr_t address;
+	unsigned int length;
+	/* True when inserting an ebreak, false when restoring orig_instr. */
+	bool insert;
+	/* The bytes to write. */
+	uint8_t data[4];
+};
+
+static bool sw_breakpoint_op_overlaps(const struct riscv_sw_breakpoint_op *op,
+		target_addr_t address, target_addr_t size)
+{
+	return op->address < address + size && address < op->address + op->length;
+}
+
+/* Returns the index of the last pending write that touches
+ * [address, address + size), or -1 if there is none. */
+static int sw_breakpoint_op_last_overlapping(const struct riscv_info *r,
+		target_addr_t address, target_addr_t size)
+{
+	for (int i = r->sw_breakpoint_op_count - 1; i >= 0; i--) {
+		if (sw_breakpoint_op_overlaps(&r->sw_breakpoint_ops[i], address, size))
+			return i;
+	}
+	return -1;
+}
+
+static int sw_breakpoints_flush_target(struct target *target)
+{
+	RISCV_INFO(r);
+	unsigned int count = r->sw_breakpoint_op_count;
+	int result = ERROR_OK;
+
+	if (!count)
+		return ERROR_OK;
+
+	LOG_TARGET_DEBUG(target, "Writing %u software breakpoint changes.", count);
+
+	/* Nothing is pending anymore while the memory is written below. */
+	r->sw_breakpoint_op_count = 0;
+
+	for (unsigned int i = 0; i < count; i++) {
+		struct riscv_sw_breakpoint_op *op = &r->sw_breakpoint_ops[i];
+
+		if (riscv_write_by_any_size(target, op->address, op->length, op->data) == ERROR_OK)
+			continue;
+
+		if (op->insert)
+			LOG_TARGET_ERROR(target, "Failed to write %d-byte breakpoint instruction at 0x%"
+					TARGET_PRIxADDR, op->length, op->address);
+		else
+			LOG_TARGET_ERROR(target, "Failed to restore instruction for %d-byte breakpoint at "
+					"0x%" TARGET_PRIxADDR, op->length, op->address);
+		result = ERROR_FAIL;
+	}
+
+	return result;
+}
+
+static int sw_breakpoint_op_append(struct target *target,
+		const struct riscv_sw_breakpoint_op *op)
+{
+	RISCV_INFO(r);
+
+	if (r->sw_breakpoint_op_count == r->sw_breakpoint_op_alloc) {
+		unsigned int alloc = r->sw_breakpoint_op_alloc ? 2 * r->sw_breakpoint_op_alloc : 16;
+		struct riscv_sw_breakpoint_op *ops = realloc(r->sw_breakpoint_ops,
+				alloc * sizeof(*ops));
+		if (!ops) {
+			LOG_TARGET_ERROR(target, "Out of memory");
+			return ERROR_FAIL;
+		}
+		r->sw_breakpoint_ops = ops;
+		r->sw_breakpoint_op_alloc = alloc;
+	}
+	r->sw_breakpoint_ops[r->sw_breakpoint_op_count++] = *op;
+
+	if (target->state != TARGET_HALTED)
+		return sw_breakpoints_flush_target(target);
+	return ERROR_OK;
+}
+
+static void sw_breakpoint_op_delete(struct riscv_info *r, unsigned int i)
+{
+	memmove(&r->sw_breakpoint_ops[i], &r->sw_breakpoint_ops[i + 1],
+			(r->sw_breakpoint_op_count - i - 1) * sizeof(*r->sw_breakpoint_ops));
+	r->sw_breakpoint_op_count--;
+}
+
+/**
+ * Writes the pending software breakpoint changes to memory. The harts of an
+ * SMP group share their memory, so the changes pending on any of them are
+ * written.
+ */
+static int riscv_flush_sw_breakpoints(struct target *target)
+{
+	if (!target->smp)
+		return sw_breakpoints_flush_target(target);
+
+	int result = ERROR_OK;
+	struct target_list *entry;
+	foreach_smp_target(entry, target->smp_targets) {
+		if (sw_breakpoints_flush_target(entry->target) != ERROR_OK)
+			result = ERROR_FAIL;
+	}
+	return result;
+}
+
+static bool sw_breakpoints_pending_target(struct target *target,
+		target_addr_t address, target_addr_t size)
+{
+	RISCV_INFO(r);
+	return sw_breakpoint_op_last_overlapping(r, address, size) >= 0;
+}
+
+/* Returns true if a software breakpoint change pending on @a target or its
+ * SMP group touches [address, address + size). */
+static bool riscv_sw_breakpoints_pending(struct target *target,
+		target_addr_t address, target_addr_t size)
+{
+	if (!target->smp)
+		return sw_breakpoints_pending_target(target, address, size);
+
+	struct target_list *entry;
+	foreach_smp_target(entry, target->smp_targets) {
+		if (sw_breakpoints_pending_target(entry->target, address, size))
+			return true;
+	}
+	return false;
+}
+
+static void sw_breakpoints_patch_target(struct target *target,
+		target_addr_t address, target_addr_t size, uint8_t *buffer)
+{
+	RISCV_INFO(r);
+
+	for (unsigned int i = 0; i < r->sw_breakpoint_op_count; i++) {
+		const struct riscv_sw_breakpoint_op *op = &r->sw_breakpoint_ops[i];
+		if (!sw_breakpoint_op_overlaps(op, address, size))
+			continue;
+
+		for (unsigned int j = 0; j < op->length; j++) {
+			target_addr_t a = op->address + j;
+			if (a >= address && a < address + size)
+				buffer[a - address] = op->data[j];
+		}
+	}
+}
+
+/* Makes @a buffer, just read from [address, address + size), look as if the
+ * pending software breakpoint changes had been written. */
+static void riscv_sw_breakpoints_patch(struct target *target,
+		target_addr_t address, target_addr_t size, uint8_t *buffer)
+{
+	if (!target->smp) {
+		sw_breakpoints_patch_target(target, address, size, buffer);
+		return;
+	}
+
+	struct target_list *entry;
+	foreach_smp_target(entry, target->smp_targets)
+		sw_breakpoints_patch_target(entry->target, address, size, buffer);
+}
+
 static int riscv_add_breakpoint(struct target *target, struct breakpoint *breakpoint)
 {
 	LOG_TARGET_DEBUG(target, "@0x%" TARGET_PRIxADDR, breakpoint->address);
@@ -1621,6 +1800,20 @@ static int riscv_add_breakpoint(struct target *target, struct breakpoint *breakp
 			return ERROR_FAIL;
 		}
 
+		RISCV_INFO(r);
+		int i = sw_breakpoint_op_last_overlapping(r, breakpoint->address, breakpoint->length);
+		if (i >= 0) {
+			struct riscv_sw_breakpoint_op *pending = &r->sw_breakpoint_ops[i];
+			if (!pending->insert && pending->address == breakpoint->address &&
+					pending->length == breakpoint->length) {
+				/* The ebreak of a removed breakpoint is still in memory. */
+				memcpy(breakpoint->orig_instr, pending->data, breakpoint->length);
+				sw_breakpoint_op_delete(r, i);
+				breakpoint->is_set = true;
+				return ERROR_OK;
+			}
+		}
+
 		/* Read the original instruction. */
 		if (riscv_read_by_any_size(
 				target, breakpoint->address, breakpoint->length, breakpoint->orig_instr) != ERROR_OK) {
@@ -1629,14 +1822,15 @@ static int riscv_add_breakpoint(struct target *target, struct breakpoint *breakp
 			return ERROR_FAIL;
 		}
 
-		uint8_t buff[4] = { 0 };
-		buf_set_u32(buff, 0, breakpoint->length * CHAR_BIT, breakpoint->length == 4 ? ebreak() : ebreak_c());
-		/* Write the ebreak instruction. */
-		if (riscv_write_by_any_size(target, breakpoint->address, breakpoint->length, buff) != ERROR_OK) {
-			LOG_TARGET_ERROR(target, "Failed to write %d-byte breakpoint instruction at 0x%"
-					TARGET_PRIxADDR, breakpoint->length, breakpoint->address);
+		/* Queue the ebreak instruction. */
+		struct riscv_sw_breakpoint_op op = {
+			.address = breakpoint->address,
+			.length = breakpoint->length,
+			.insert = true,
+		};
+		buf_set_u32(op.data, 0, breakpoint->length * CHAR_BIT, breakpoint->length == 4 ? ebreak() : ebreak_c());
+		if (sw_breakpoint_op_append(target, &op) != ERROR_OK)
 			return ERROR_FAIL;
-		}
 		breakpoint->is_set = true;
 
 	} else if (breakpoint->type == BKPT_HARD) {
@@ -1693,12 +1887,23 @@ static int riscv_remove_breakpoint(struct target *target,
 		struct breakpoint *breakpoint)
 {
 	if (breakpoint->type == BKPT_SOFT) {
-		/* Write the original instruction. */
-		if (riscv_write_by_any_size(
-				target, breakpoint->address, breakpoint->length, breakpoint->orig_instr) != ERROR_OK) {
-			LOG_TARGET_ERROR(target, "Failed to restore instruction for %d-byte breakpoint at "
-					"0x%" TARGET_PRIxADDR, breakpoint->length, breakpoint->address);
-			return ERROR_FAIL;
+		RISCV_INFO(r);
+		int i = sw_breakpoint_op_last_overlapping(r, breakpoint->address, breakpoint->length);
+		if (i >= 0 && r->sw_breakpoint_ops[i].insert &&
+				r->sw_breakpoint_ops[i].address == breakpoint->address &&
+				r->sw_breakpoint_ops[i].length == breakpoint->length) {
+			/* The ebreak instruction was never written. */
+			sw_breakpoint_op_delete(r, i);
+		} else {
+			/* Queue the original instruction. */
+			struct riscv_sw_breakpoint_op op = {
+				.address = breakpoint->address,
+				.length = breakpoint->length,
+				.insert = false,
+			};
+			memcpy(op.data, breakpoint->orig_instr, breakpoint->length);
+			if (sw_breakpoint_op_append(target, &op) != ERROR_OK)
+				return ERROR_FAIL;
 		}
 
 	} else if (breakpoint->type == BKPT_HARD) {
@@ -2455,6 +2660,8 @@ static int old_or_new_riscv_step_impl(struct target *target, bool current,
 	RISCV_INFO(r);
 	LOG_TARGET_DEBUG(target, "handle_breakpoints=%s",
 			handle_breakpoints ? "true" : "false");
+	if (riscv_flush_sw_breakpoints(target) != ERROR_OK)
+		return ERROR_FAIL;
 	if (!r->get_hart_state)
 		return oldriscv_step(target, current, address, handle_breakpoints);
 	else
@@ -2764,6 +2971,12 @@ static int riscv_assert_reset(struct target *target)
 	if (riscv_reg_cache_any_dirty(target, LOG_LVL_INFO))
 		LOG_TARGET_INFO(target, "Discarding values of dirty registers.");
 
+	if (riscv_flush_sw_breakpoints(target) != ERROR_OK)
+		LOG_TARGET_WARNING(target, "Failed to write software breakpoints before reset.");
+
+	/* The program may be a different one after the reset. */
+	riscv_info(target)->semihosting_call_site.valid = false;
+
 	riscv_reg_cache_invalidate_all(target);
 	return tt->assert_reset(target);
 }
@@ -2854,6 +3067,12 @@ static int resume_prep(struct target *target, bool current,
 		}
 	}
 
+	/* Write the breakpoints before the registers are flushed and the fence
+	 * runs: the writes may clobber registers, and the hart must not run old
+	 * instructions from its cache. */
+	if (riscv_flush_sw_breakpoints(target) != ERROR_OK)
+		return ERROR_FAIL;
+
 	if (r->get_hart_state) {
 		if (r->resume_prep(target) != ERROR_OK)
 			return ERROR_FAIL;
@@ -3380,6 +3599,8 @@ static int riscv_read_phys_memory(struct target *target, target_addr_t phys_addr
 		.increment = size,
 	};
 	RISCV_INFO(r);
+	if (riscv_flush_sw_breakpoints(target) != ERROR_OK)
+		return ERROR_FAIL;
 	return r->access_memory(target, args);
 }
 
@@ -3395,6 +3616,9 @@ static int riscv_write_phys_memory(struct target *target, target_addr_t phys_add
 	};
 
 	RISCV_INFO(r);
+	if (riscv_flush_sw_breakpoints(target) != ERROR_OK)
+		return ERROR_FAIL;
+	riscv_semihosting_memory_written(target, phys_address, (target_addr_t)size * count);
 	return r->access_memory(target, args);
 }
 
@@ -3469,7 +3693,10 @@ static int riscv_read_memory(struct target *target, target_addr_t address,
 		.increment = size,
 	};
 
-	return riscv_rw_memory(target, args);
+	int result = riscv_rw_memory(target, args);
+	if (result == ERROR_OK)
+		riscv_sw_breakpoints_patch(target, address, (target_addr_t)size * count, buffer);
+	return result;
 }
 
 static int riscv_write_memory(struct target *target, target_addr_t address,
@@ -3483,6 +3710,10 @@ static int riscv_write_memory(struct target *target, target_addr_t address,
 		.increment = size,
 	};
 
+	if (riscv_sw_breakpoints_pending(target, address, (target_addr_t)size * count) &&
+			riscv_flush_sw_breakpoints(target) != ERROR_OK)
+		return ERROR_FAIL;
+	riscv_semihosting_memory_written(target, address, (target_addr_t)size * count);
 	return riscv_rw_memory(target, args);
 }
 
@@ -3498,6 +3729,26 @@ static const char *riscv_get_gdb_arch(const struct target *target)
 	return NULL;
 }
 
+static int riscv_read_registers(struct target *target, struct reg **reg_list,
+		int reg_list_size)
+{
+	RISCV_INFO(r);
+
+	if (!r->read_registers)
+		return ERROR_OK;
+	return r->read_registers(target, reg_list, reg_list_size);
+}
+
+static int riscv_write_registers(struct target *target, struct reg **reg_list,
+		int reg_list_size)
+{
+	if (target->state != TARGET_HALTED)
+		return ERROR_OK;
+	/* Writing back every dirty register is fine while halted, and lets
+	 * the GPRs go out in one batch. */
+	return riscv_reg_flush_all(target);
+}
+
 static int riscv_get_gdb_reg_list_internal(struct target *target,
 		struct reg **reg_list[], int *reg_list_size,
 		enum target_register_class reg_class, bool is_read)
@@ -3529,6 +3780,13 @@ static int riscv_get_gdb_reg_list_internal(struct target *target,
 		assert(!target->reg_cache->reg_list[i].valid ||
 				target->reg_cache->reg_list[i].size > 0);
 		(*reg_list)[i] = &target->reg_cache->reg_list[i];
+	}
+
+	if (is_read && riscv_read_registers(target, *reg_list,
+				*reg_list_size) != ERROR_OK)
+		return ERROR_FAIL;
+
+	for (int i = 0; i < *reg_list_size; i++) {
 		if (is_read &&
 				target->reg_cache->reg_list[i].exist &&
 				!target->reg_cache->reg_list[i].valid) {
@@ -3827,6 +4085,147 @@ static int riscv_checksum_memory(struct target *target,
 	return retval;
 }
 
+/** Checks an array of memory regions whether they are erased. */
+static int riscv_blank_check_memory(struct target *target,
+		struct target_memory_check_block *blocks, int num_blocks,
+		uint8_t erased_value)
+{
+	struct working_area *erase_check_algorithm;
+	struct working_area *erase_check_params;
+	struct reg_param reg_params[2];
+	int retval;
+
+	static const uint8_t riscv32_erase_check_code[] = {
+#include "../../../contrib/loaders/erase_check/riscv32_erase_check.inc"
+	};
+	static const uint8_t riscv64_erase_check_code[] = {
+#include "../../../contrib/loaders/erase_check/riscv64_erase_check.inc"
+	};
+
+	if (target->state != TARGET_HALTED) {
+		LOG_TARGET_ERROR(target, "not halted (blank check)");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	unsigned int xlen = riscv_xlen(target);
+	const uint8_t *erase_check_code;
+	unsigned int code_size;
+	if (xlen == 32) {
+		erase_check_code = riscv32_erase_check_code;
+		code_size = sizeof(riscv32_erase_check_code);
+	} else {
+		erase_check_code = riscv64_erase_check_code;
+		code_size = sizeof(riscv64_erase_check_code);
+	}
+
+	/* The algorithm compares whole words, and a zero size ends the list. */
+	int blocks_to_check = 0;
+	while (blocks_to_check < num_blocks &&
+			blocks[blocks_to_check].size >= 4 &&
+			blocks[blocks_to_check].size % 4 == 0 &&
+			blocks[blocks_to_check].address % 4 == 0)
+		blocks_to_check++;
+	if (!blocks_to_check)
+		return ERROR_FAIL;
+
+	retval = target_alloc_algorithm_working_area(target,
+			xlen == 32 ? "riscv32_erase_check" : "riscv64_erase_check",
+			erase_check_code, code_size, &erase_check_algorithm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* Each block is { xlen size_in_result_out, xlen address }. */
+	const unsigned int block_bytes = 2 * xlen / 8;
+	uint32_t avail = target_get_working_area_avail(target);
+	if (avail / block_bytes < 2) {
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto cleanup1;
+	}
+	if ((uint32_t)blocks_to_check > avail / block_bytes - 1)
+		blocks_to_check = avail / block_bytes - 1;
+
+	uint32_t param_size = (blocks_to_check + 1) * block_bytes;
+	uint8_t *params = calloc(1, param_size);
+	if (!params) {
+		retval = ERROR_FAIL;
+		goto cleanup1;
+	}
+
+	uint64_t total_size = 0;
+	for (int i = 0; i < blocks_to_check; i++) {
+		total_size += blocks[i].size;
+		buf_set_u64(params + i * block_bytes, 0, xlen, blocks[i].size / 4);
+		buf_set_u64(params + i * block_bytes + block_bytes / 2, 0, xlen,
+				blocks[i].address);
+	}
+
+	if (target_alloc_working_area(target, param_size, &erase_check_params) != ERROR_OK) {
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		goto cleanup2;
+	}
+
+	retval = target_write_buffer(target, erase_check_params->address,
+			param_size, params);
+	if (retval != ERROR_OK)
+		goto cleanup3;
+
+	uint32_t erased_word = erased_value | (erased_value << 8)
+			| (erased_value << 16) | (erased_value << 24);
+
+	LOG_TARGET_DEBUG(target, "Starting erase check of %d blocks, parameters@"
+			TARGET_ADDR_FMT, blocks_to_check, erase_check_params->address);
+
+	init_reg_param(&reg_params[0], "a0", xlen, PARAM_OUT);
+	buf_set_u64(reg_params[0].value, 0, xlen, erase_check_params->address);
+
+	/* lw sign-extends, so the value to compare with must be too. */
+	init_reg_param(&reg_params[1], "a1", xlen, PARAM_OUT);
+	buf_set_u64(reg_params[1].value, 0, xlen, (int64_t)(int32_t)erased_word);
+
+	/* Assume the hart runs at 1 MHz at least. A timeout loses all results,
+	 * so be generous. */
+	unsigned int timeout = 2000 + total_size * 3 / 1000;
+
+	retval = target_run_algorithm(target, 0, NULL,
+			ARRAY_SIZE(reg_params), reg_params,
+			erase_check_algorithm->address,
+			erase_check_algorithm->address + code_size - 4,
+			timeout, NULL);
+	if (retval != ERROR_OK) {
+		LOG_TARGET_ERROR(target, "Error executing RISC-V erase check algorithm.");
+		goto cleanup4;
+	}
+
+	retval = target_read_buffer(target, erase_check_params->address,
+			param_size, params);
+	if (retval != ERROR_OK)
+		goto cleanup4;
+
+	int i;
+	for (i = 0; i < blocks_to_check; i++) {
+		uint64_t result = buf_get_u64(params + i * block_bytes, 0, xlen);
+		if (result != 0 && result != 1)
+			break;
+
+		blocks[i].result = result;
+	}
+
+	retval = i;		/* return number of blocks really checked */
+
+cleanup4:
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+
+cleanup3:
+	target_free_working_area(target, erase_check_params);
+cleanup2:
+	free(params);
+cleanup1:
+	target_free_working_area(target, erase_check_algorithm);
+
+	return retval;
+}
+
 /*** OpenOCD Helper Functions ***/
 
 enum riscv_next_action {
@@ -3928,6 +4327,8 @@ static int riscv_poll_hart(struct target *target, enum riscv_next_action *next_a
 			 * going to figure out the "current thread". */
 
 			r->halted_needs_event_callback = true;
+			/* Memory may change behind our back before the next resume. */
+			r->semihosting_call_site.valid = false;
 			if (previous_target_state == TARGET_DEBUG_RUNNING)
 				r->halted_callback_event = TARGET_EVENT_DEBUG_HALTED;
 			else
@@ -4012,6 +4413,108 @@ exit:
 	return result;
 }
 
+static int riscv_profiling(struct target *target, uint32_t *samples,
+		uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds)
+{
+	RISCV_INFO(r);
+
+	if (!r->profile_pc.enabled || !r->sample_pc)
+		return target_profiling_default(target, samples, max_num_samples,
+				num_samples, seconds);
+
+	LOG_TARGET_INFO(target, "Starting RISC-V profiling. Sampling PC at 0x%"
+			TARGET_PRIxADDR " as fast as we can...", r->profile_pc.address);
+
+	/* Make sure the target is running */
+	int result = target_poll(target);
+	if (result != ERROR_OK)
+		return result;
+	if (target->state == TARGET_HALTED) {
+		result = target_resume(target, true, 0, false, false);
+		if (result != ERROR_OK) {
+			LOG_TARGET_ERROR(target, "Error while resuming target");
+			return result;
+		}
+	}
+
+	result = r->sample_pc(target, r->profile_pc.address,
+			r->profile_pc.size_bytes, samples, max_num_samples, num_samples,
+			timeval_ms() + (int64_t)seconds * 1000);
+	if (result == ERROR_NOT_IMPLEMENTED)
+		return target_profiling_default(target, samples, max_num_samples,
+				num_samples, seconds);
+	if (result != ERROR_OK) {
+		LOG_TARGET_ERROR(target, "Error while sampling PC");
+		return result;
+	}
+
+	LOG_TARGET_INFO(target, "Profiling completed. %" PRIu32 " samples.", *num_samples);
+	return ERROR_OK;
+}
+
+static int riscv_sample_pc(struct target *target, uint32_t *samples,
+		uint32_t max_num_samples, uint32_t *num_samples)
+{
+	RISCV_INFO(r);
+
+	if (!r->profile_pc.enabled || !r->sample_pc)
+		return ERROR_NOT_IMPLEMENTED;
+
+	/* until_ms is already over, so this is a single batch */
+	return r->sample_pc(target, r->profile_pc.address, r->profile_pc.size_bytes,
+			samples, max_num_samples, num_samples, timeval_ms());
+}
+
+/* Checks with a single read of the Debug Module whether any hart of an SMP
+ * group changed its state since the last poll. Only if one did, or if the
+ * harts can't be read together, are they polled one by one. */
+static bool riscv_group_unchanged(struct target *target, struct list_head *targets)
+{
+	RISCV_INFO(r);
+
+	if (!target->smp || !r->get_group_state)
+		return false;
+
+	bool halted = false;
+	bool running = false;
+	struct target_list *entry;
+	foreach_smp_target(entry, targets) {
+		switch (entry->target->state) {
+		case TARGET_HALTED:
+			halted = true;
+			break;
+		case TARGET_RUNNING:
+		case TARGET_DEBUG_RUNNING:
+			running = true;
+			break;
+		default:
+			return false;
+		}
+	}
+	if (halted == running)
+		return false;
+
+	bool uniform;
+	enum riscv_hart_state state;
+	if (r->get_group_state(target, targets, &uniform, &state) != ERROR_OK)
+		return false;
+	if (!uniform || (state == RISCV_STATE_HALTED) != halted)
+		return false;
+
+	if (halted) {
+		/* Same as riscv_poll_hart() does for an idle halted hart. */
+		foreach_smp_target(entry, targets) {
+			struct target *t = entry->target;
+			if (timeval_ms() - riscv_info(t)->last_activity > 100 &&
+					riscv_reg_flush_all(t) != ERROR_OK)
+				return false;
+		}
+	}
+
+	LOG_TARGET_DEBUG(target, "No hart of the SMP group changed its state.");
+	return true;
+}
+
 /*** OpenOCD Interface ***/
 int riscv_openocd_poll(struct target *target)
 {
@@ -4042,6 +4545,10 @@ int riscv_openocd_poll(struct target *target)
 	unsigned int running = 0;
 	unsigned int cause_groups = 0;
 	struct target_list *entry;
+
+	if (riscv_group_unchanged(target, targets))
+		goto settled;
+
 	foreach_smp_target(entry, targets) {
 		struct target *t = entry->target;
 		struct riscv_info *info = riscv_info(t);
@@ -4158,6 +4665,7 @@ int riscv_openocd_poll(struct target *target)
 		}
 	}
 
+settled:
 	i->halt_group_repoll_count = 0;
 
 	/* Call tick() for every hart. What happens in tick() is opaque to this
@@ -4205,6 +4713,9 @@ static int riscv_openocd_step_impl(struct target *target, bool current,
 			return ERROR_FAIL;
 	}
 
+	if (riscv_flush_sw_breakpoints(target) != ERROR_OK)
+		return ERROR_FAIL;
+
 	if (riscv_enumerate_triggers(target) != ERROR_OK)
 		return ERROR_FAIL;
 
@@ -5290,6 +5801,47 @@ COMMAND_HANDLER(handle_memory_sample_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_profile_pc_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	RISCV_INFO(r);
+
+	if (CMD_ARGC == 0) {
+		if (r->profile_pc.enabled)
+			command_print(CMD, "address=0x%" TARGET_PRIxADDR "; size=%" PRIu32,
+						  r->profile_pc.address, r->profile_pc.size_bytes);
+		else
+			command_print(CMD, "disabled");
+		return ERROR_OK;
+	}
+
+	if (CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!strcmp(CMD_ARGV[0], "clear")) {
+		if (CMD_ARGC != 1)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		r->profile_pc.enabled = false;
+		return ERROR_OK;
+	}
+
+	COMMAND_PARSE_ADDRESS(CMD_ARGV[0], r->profile_pc.address);
+
+	if (CMD_ARGC > 1) {
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], r->profile_pc.size_bytes);
+		if (r->profile_pc.size_bytes != 4 && r->profile_pc.size_bytes != 8) {
+			LOG_TARGET_ERROR(target, "Only 4-byte and 8-byte sizes are supported.");
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+	} else {
+		r->profile_pc.size_bytes = 4;
+	}
+
+	r->profile_pc.enabled = true;
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_dump_sample_buf_command)
 {
 	struct target *target = get_current_target(CMD_CTX);
@@ -5598,6 +6150,14 @@ static const struct command_registration riscv_exec_command_handlers[] = {
 		.usage = "bucket address|clear [size=4]",
 		.help = "Causes OpenOCD to frequently read size bytes at the given address."
 	},
+	{
+		.name = "profile_pc",
+		.handler = handle_profile_pc_command,
+		.mode = COMMAND_ANY,
+		.usage = "[address|clear [size=4]]",
+		.help = "Make the profile command sample the PC from the given address "
+			"without halting the hart."
+	},
 	{
 		.name = "repeat_read",
 		.handler = handle_repeat_read,
@@ -5914,6 +6474,7 @@ struct target_type riscv_target = {
 	.write_phys_memory = riscv_write_phys_memory,
 
 	.checksum_memory = riscv_checksum_memory,
+	.blank_check_memory = riscv_blank_check_memory,
 
 	.mmu = riscv_mmu,
 	.virt2phys = riscv_virt2phys,
@@ -5921,6 +6482,8 @@ struct target_type riscv_target = {
 	.get_gdb_arch = riscv_get_gdb_arch,
 	.get_gdb_reg_list = riscv_get_gdb_reg_list,
 	.get_gdb_reg_list_noread = riscv_get_gdb_reg_list_noread,
+	.read_registers = riscv_read_registers,
+	.write_registers = riscv_write_registers,
 
 	.add_breakpoint = riscv_add_breakpoint,
 	.remove_breakpoint = riscv_remove_breakpoint,
@@ -5933,6 +6496,9 @@ struct target_type riscv_target = {
 
 	.run_algorithm = riscv_run_algorithm,
 
+	.profiling = riscv_profiling,
+	.sample_pc = riscv_sample_pc,
+
 	.commands = riscv_command_handlers,
 
 	.address_bits = riscv_xlen_nonconst,
@@ -164,6 +164,7 @@ riscv_mem_access_is_write(const struct riscv_mem_access_args args)
 	return !args.read_buffer && args.write_buffer;
 }
 
+struct riscv_sw_breakpoint_op;
 
 struct riscv_info {
 	unsigned int common_magic;
@@ -241,12 +242,33 @@ struct riscv_info {
 	enum target_event halted_callback_event;
 	unsigned int halt_group_repoll_count;
 
+	/* Address of the ebreak of the last handled semihosting call, so
+	 * back-to-back calls from the same place do not read the instructions
+	 * around it again. Forgotten on any halt that is reported, on reset and
+	 * when memory around it is written. */
+	struct {
+		bool valid;
+		target_addr_t address;
+	} semihosting_call_site;
+
 	enum riscv_isrmasking_mode isrmask_mode;
 
+	/* Software breakpoint inserts and removals that have not been written
+	 * to memory yet, see riscv_flush_sw_breakpoints(). */
+	struct riscv_sw_breakpoint_op *sw_breakpoint_ops;
+	unsigned int sw_breakpoint_op_count;
+	unsigned int sw_breakpoint_op_alloc;
+
 	/* Helper functions that target the various RISC-V debug spec
 	 * implementations. */
 	int (*select_target)(struct target *target);
 	int (*get_hart_state)(struct target *target, enum riscv_hart_state *state);
+	/* Read the state of all the harts in @a targets in one go. Sets
+	 * @a uniform if they are all in @a state, which is either running or
+	 * halted, and none of them was reset. Returns ERROR_NOT_IMPLEMENTED if
+	 * the harts can't be read together. */
+	int (*get_group_state)(struct target *target, struct list_head *targets,
+			bool *uniform, enum riscv_hart_state *state);
 	/* Resume this target, as well as every other prepped target that can be
 	 * resumed near-simultaneously. Clear the prepped flag on any target that
 	 * was resumed. */
@@ -303,8 +325,19 @@ struct riscv_info {
 						 riscv_sample_config_t *config,
 						 int64_t until_ms);
 
+	/* Repeatedly read the PC mirror at address without halting the hart,
+	 * until max_num_samples are collected or until_ms is reached. */
+	int (*sample_pc)(struct target *target, target_addr_t address,
+			uint32_t size_bytes, uint32_t *samples, uint32_t max_num_samples,
+			uint32_t *num_samples, int64_t until_ms);
+
 	int (*access_memory)(struct target *target, const struct riscv_mem_access_args args);
 
+	/* Optional. Read the invalid registers of reg_list into the register
+	 * cache in one batch. Registers left invalid are read one by one. */
+	int (*read_registers)(struct target *target, struct reg **reg_list,
+			int reg_list_size);
+
 	unsigned int (*data_bits)(struct target *target);
 
 	COMMAND_HELPER((*print_info), struct target *target);
@@ -353,6 +386,15 @@ struct riscv_info {
 	riscv_sample_config_t sample_config;
 	struct riscv_sample_buf sample_buf;
 
+	/* Memory-mapped location that holds the current PC of the hart, e.g. a
+	 * PC sampling register or a mirror maintained by the firmware. When
+	 * set, `profile` samples it instead of halting the hart. */
+	struct {
+		bool enabled;
+		target_addr_t address;
+		uint32_t size_bytes;
+	} profile_pc;
+
 	/* Track when we were last asked to do something substantial. */
 	int64_t last_activity;
 
@@ -496,6 +538,8 @@ int riscv_remove_watchpoint(struct target *target,
 void riscv_semihosting_init(struct target *target);
 
 enum semihosting_result riscv_semihosting(struct target *target, int *retval);
+void riscv_semihosting_memory_written(struct target *target,
+		target_addr_t address, target_addr_t size);
 
 void riscv_add_bscan_tunneled_scan(struct jtag_tap *tap, const struct scan_field *field,
 		riscv_bscan_tunneled_scan_context_t *ctxt);
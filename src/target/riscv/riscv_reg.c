@@ -769,31 +769,51 @@ void riscv_reg_free_all(struct target *target)
 			free(target->reg_cache->reg_list[i].value);
 		free(target->reg_cache->reg_list);
 	}
+	register_cache_free_index(target->reg_cache);
 	free(target->reg_cache);
 	target->reg_cache = NULL;
 }
 
+static int riscv_reg_flush(struct target *target, enum gdb_regno number)
+{
+	struct reg *reg = riscv_reg_impl_cache_entry(target, number);
+	if (!reg->valid || !reg->dirty)
+		return ERROR_OK;
+
+	riscv_reg_t value = buf_get_u64(reg->value, 0, reg->size);
+
+	LOG_TARGET_DEBUG(target, "%s is dirty; write back 0x%" PRIx64,
+			reg->name, value);
+	return riscv_reg_write(target, number, value);
+}
+
 int riscv_reg_flush_all(struct target *target)
 {
 	if (!target->reg_cache)
 		return ERROR_OK;
 
+	RISCV_INFO(r);
+
 	LOG_TARGET_DEBUG(target, "Flushing register cache");
 
 	/* Writing non-GPR registers may require progbuf execution, and some GPRs
 	 * may become dirty in the process (e.g. S0, S1). For that reason, flush
 	 * registers in reverse order, so that GPRs are flushed last.
 	 */
-	for (unsigned int number = target->reg_cache->num_regs; number-- > 0; ) {
-		struct reg *reg = riscv_reg_impl_cache_entry(target, number);
-		if (reg->valid && reg->dirty) {
-			riscv_reg_t value = buf_get_u64(reg->value, 0, reg->size);
-
-			LOG_TARGET_DEBUG(target, "%s is dirty; write back 0x%" PRIx64,
-					reg->name, value);
-			if (riscv_reg_write(target, number, value) != ERROR_OK)
-				return ERROR_FAIL;
-		}
+	for (unsigned int number = target->reg_cache->num_regs - 1;
+			number > GDB_REGNO_XPR31; number--) {
+		if (riscv_reg_flush(target, number) != ERROR_OK)
+			return ERROR_FAIL;
+	}
+
+	/* Write back as many GPRs as possible at once. */
+	if (r->dtm_version == DTM_DTMCS_VERSION_1_0 &&
+			riscv013_flush_dirty_gprs(target) != ERROR_OK)
+		return ERROR_FAIL;
+
+	for (int number = GDB_REGNO_XPR31; number >= GDB_REGNO_ZERO; number--) {
+		if (riscv_reg_flush(target, number) != ERROR_OK)
+			return ERROR_FAIL;
 	}
 	LOG_TARGET_DEBUG(target, "Flush of register cache completed");
 	return ERROR_OK;
@@ -30,6 +30,7 @@
 
 #include <helper/log.h>
 
+#include "target/breakpoints.h"
 #include "target/target.h"
 #include "riscv.h"
 #include "riscv_reg.h"
@@ -117,11 +118,25 @@ enum semihosting_result riscv_semihosting(struct target *target, int *retval)
 		return SEMIHOSTING_ERROR;
 	}
 
+	RISCV_INFO(r);
+	const bool known_call_site = r->semihosting_call_site.valid &&
+		r->semihosting_call_site.address == pc && !breakpoint_find(target, pc);
+	/* Only remembered again if this call is handled and the hart resumed. */
+	r->semihosting_call_site.valid = false;
+
 	bool sequence_found = false;
-	*retval = riscv_semihosting_detect_magic_sequence(target, pc, &sequence_found);
-	if (*retval != ERROR_OK) {
-		LOG_TARGET_DEBUG(target, "Semihosting outcome: ERROR (during magic seq. detection)");
-		return SEMIHOSTING_ERROR;
+	if (known_call_site) {
+		/* A program usually makes all its semihosting calls from one
+		 * function, skip reading the same three instructions each time. */
+		LOG_TARGET_DEBUG(target, "RISC-V semihosting sequence known "
+			"at PC = 0x%" TARGET_PRIxADDR, pc);
+		sequence_found = true;
+	} else {
+		*retval = riscv_semihosting_detect_magic_sequence(target, pc, &sequence_found);
+		if (*retval != ERROR_OK) {
+			LOG_TARGET_DEBUG(target, "Semihosting outcome: ERROR (during magic seq. detection)");
+			return SEMIHOSTING_ERROR;
+		}
 	}
 
 	if (!semihosting->is_active) {
@@ -205,6 +220,8 @@ enum semihosting_result riscv_semihosting(struct target *target, int *retval)
 	 */
 	if (semihosting->is_resumable && !semihosting->hit_fileio) {
 		LOG_TARGET_DEBUG(target, "Semihosting outcome: HANDLED");
+		r->semihosting_call_site.valid = true;
+		r->semihosting_call_site.address = pc;
 		return SEMIHOSTING_HANDLED;
 	}
 
@@ -212,6 +229,25 @@ enum semihosting_result riscv_semihosting(struct target *target, int *retval)
 	return SEMIHOSTING_WAITING;
 }
 
+/**
+ * Forget the cached semihosting call site if it overlaps with @a size bytes
+ * of memory at @a address that are about to be written.
+ */
+void riscv_semihosting_memory_written(struct target *target,
+		target_addr_t address, target_addr_t size)
+{
+	RISCV_INFO(r);
+
+	if (!r->semihosting_call_site.valid)
+		return;
+
+	/* The sequence starts one instruction before the ebreak and ends one
+	 * instruction after it. */
+	const target_addr_t start = r->semihosting_call_site.address - 4;
+	if (address < start + 12 && address + size > start)
+		r->semihosting_call_site.valid = false;
+}
+
 /* -------------------------------------------------------------------------
  * Local functions. */
 
@@ -403,7 +403,7 @@ int target_rtt_read_callback(struct target *target,
 		}
 
 		for (struct rtt_sink_list *sink = sinks[i]; sink; sink = sink->next)
-			sink->read(i, buffer, length, sink->user_data);
+			sink->read(i, buffer, &length, sink->user_data);
 	}
 
 	return ERROR_OK;
@@ -139,6 +139,8 @@ int semihosting_common_init(struct target *target, void *setup,
 	semihosting->sys_errno = -1;
 	semihosting->cmdline = NULL;
 	semihosting->basedir = NULL;
+	semihosting->console_length = 0;
+	semihosting->console_timer_pending = false;
 
 	/* If possible, update it in setup(). */
 	semihosting->setup_time = clock();
@@ -257,15 +259,6 @@ static ssize_t semihosting_redirect_read(struct semihosting *semihosting, void *
 	return retval;
 }
 
-static inline int semihosting_putchar(struct semihosting *semihosting, int fd, int c)
-{
-	if (semihosting_is_redirected(semihosting, fd))
-		return semihosting_redirect_write(semihosting, &c, 1);
-
-	/* default putchar */
-	return putchar(c);
-}
-
 static inline ssize_t semihosting_read(struct semihosting *semihosting, int fd, void *buf, int size)
 {
 	if (semihosting_is_redirected(semihosting, fd))
@@ -294,6 +287,109 @@ static inline int semihosting_getchar(struct semihosting *semihosting, int fd)
 	return getchar();
 }
 
+/**
+ * Writes the output of SYS_WRITEC and SYS_WRITE0 collected so far.
+ */
+static void semihosting_console_flush(struct semihosting *semihosting)
+{
+	if (!semihosting->console_length)
+		return;
+
+	/* debug operations are redirected when CFG is either DEBUG or ALL */
+	if (semihosting->redirect_cfg == SEMIHOSTING_REDIRECT_CFG_DEBUG ||
+			semihosting->redirect_cfg == SEMIHOSTING_REDIRECT_CFG_ALL) {
+		semihosting_redirect_write(semihosting, semihosting->console_buffer,
+				semihosting->console_length);
+	} else {
+		fwrite(semihosting->console_buffer, 1, semihosting->console_length, stdout);
+		fflush(stdout);
+	}
+	semihosting->console_length = 0;
+}
+
+static int semihosting_console_timer(void *priv)
+{
+	struct target *target = priv;
+
+	target->semihosting->console_timer_pending = false;
+	semihosting_console_flush(target->semihosting);
+	return ERROR_OK;
+}
+
+/**
+ * Adds console output to the buffer. Programs often print a character or
+ * a short string per call; writing it to the host (or to the TCP client)
+ * a line at a time costs one write instead of one per character.
+ */
+static void semihosting_console_write(struct target *target, const uint8_t *data, size_t size)
+{
+	struct semihosting *semihosting = target->semihosting;
+	bool end_of_line = memchr(data, '\n', size);
+
+	while (size) {
+		size_t count = MIN(size, SEMIHOSTING_CONSOLE_BUFFER_SIZE - semihosting->console_length);
+		memcpy(semihosting->console_buffer + semihosting->console_length, data, count);
+		semihosting->console_length += count;
+		data += count;
+		size -= count;
+		if (semihosting->console_length == SEMIHOSTING_CONSOLE_BUFFER_SIZE)
+			semihosting_console_flush(semihosting);
+	}
+
+	if (end_of_line) {
+		semihosting_console_flush(semihosting);
+	} else if (semihosting->console_length && !semihosting->console_timer_pending) {
+		/* Do not hold back a prompt or a partial line for long */
+		if (target_register_timer_callback(semihosting_console_timer, 100,
+				TARGET_TIMER_TYPE_ONESHOT, target) == ERROR_OK)
+			semihosting->console_timer_pending = true;
+		else
+			semihosting_console_flush(semihosting);
+	}
+}
+
+/* Strings are fetched from the target this many bytes at a time */
+#define SEMIHOSTING_READ_AHEAD 64
+
+/**
+ * Reads target memory from @a addr up to the next SEMIHOSTING_READ_AHEAD
+ * boundary in one transfer. Memory that cannot be read as a block, e.g. at
+ * the end of a region, is read one byte at a time.
+ * @a size is set to the number of bytes read.
+ */
+static int semihosting_read_ahead(struct target *target, uint64_t addr,
+	uint8_t *buffer, size_t *size)
+{
+	size_t count = SEMIHOSTING_READ_AHEAD - (addr % SEMIHOSTING_READ_AHEAD);
+
+	if (count > 1 && target_read_buffer(target, addr, count, buffer) == ERROR_OK) {
+		*size = count;
+		return ERROR_OK;
+	}
+
+	*size = 1;
+	return target_read_memory(target, addr, 1, 1, buffer);
+}
+
+/**
+ * Flushes pending console output and frees the semihosting state of
+ * @a target.
+ */
+void semihosting_common_exit(struct target *target)
+{
+	struct semihosting *semihosting = target->semihosting;
+	if (!semihosting)
+		return;
+
+	if (semihosting->console_timer_pending)
+		target_unregister_timer_callback(semihosting_console_timer, target);
+	semihosting_console_flush(semihosting);
+
+	free(semihosting->basedir);
+	free(semihosting);
+	target->semihosting = NULL;
+}
+
 /**
  * User operation parameter string storage buffer. Contains valid data when the
  * TARGET_EVENT_SEMIHOSTING_USER_CMD_xxxxx event callbacks are running.
@@ -398,6 +494,11 @@ int semihosting_common(struct target *target)
 			  semihosting_opcode_to_str(semihosting->op),
 			  semihosting->param);
 
+	/* Keep the console output in order with everything else */
+	if (semihosting->is_fileio || (semihosting->op != SEMIHOSTING_SYS_WRITEC &&
+			semihosting->op != SEMIHOSTING_SYS_WRITE0))
+		semihosting_console_flush(semihosting);
+
 	switch (semihosting->op) {
 	case SEMIHOSTING_SYS_CLOCK:	/* 0x10 */
 		/*
@@ -1434,7 +1535,7 @@ int semihosting_common(struct target *target)
 			retval = target_read_memory(target, addr, 1, 1, &c);
 			if (retval != ERROR_OK)
 				return retval;
-			semihosting_putchar(semihosting, semihosting->stdout_fd, c);
+			semihosting_console_write(target, &c, 1);
 			semihosting->result = 0;
 		}
 		break;
@@ -1452,35 +1553,34 @@ int semihosting_common(struct target *target)
 		 * Return
 		 * None. The RETURN REGISTER is corrupted.
 		 */
-		if (semihosting->is_fileio) {
+		{
 			size_t count = 0;
 			uint64_t addr = semihosting->param;
-			for (;; addr++) {
-				unsigned char c;
-				retval = target_read_memory(target, addr, 1, 1, &c);
+			for (;;) {
+				uint8_t chunk[SEMIHOSTING_READ_AHEAD];
+				size_t size;
+				retval = semihosting_read_ahead(target, addr, chunk, &size);
 				if (retval != ERROR_OK)
 					return retval;
-				if (c == '\0')
+				uint8_t *end = memchr(chunk, '\0', size);
+				if (end)
+					size = end - chunk;
+				if (!semihosting->is_fileio)
+					semihosting_console_write(target, chunk, size);
+				count += size;
+				addr += size;
+				if (end)
 					break;
-				count++;
 			}
-			semihosting->hit_fileio = true;
-			fileio_info->identifier = "write";
-			fileio_info->param_1 = 1;
-			fileio_info->param_2 = semihosting->param;
-			fileio_info->param_3 = count;
-		} else {
-			uint64_t addr = semihosting->param;
-			do {
-				unsigned char c;
-				retval = target_read_memory(target, addr++, 1, 1, &c);
-				if (retval != ERROR_OK)
-					return retval;
-				if (!c)
-					break;
-				semihosting_putchar(semihosting, semihosting->stdout_fd, c);
-			} while (1);
-			semihosting->result = 0;
+			if (semihosting->is_fileio) {
+				semihosting->hit_fileio = true;
+				fileio_info->identifier = "write";
+				fileio_info->param_1 = 1;
+				fileio_info->param_2 = semihosting->param;
+				fileio_info->param_3 = count;
+			} else {
+				semihosting->result = 0;
+			}
 		}
 		break;
 
@@ -1801,8 +1901,15 @@ static int semihosting_service_input_handler(struct connection *connection)
 static int semihosting_service_connection_closed_handler(struct connection *connection)
 {
 	struct semihosting_tcp_service *service = connection->service->priv;
-	if (service)
+	if (service) {
+		struct semihosting *semihosting = service->semihosting;
+		if (semihosting->tcp_connection == connection) {
+			/* Last chance for buffered console output to reach the client */
+			semihosting_console_flush(semihosting);
+			semihosting->tcp_connection = NULL;
+		}
 		free(service->name);
+	}
 
 	return ERROR_OK;
 }
@@ -72,6 +72,9 @@ enum semihosting_operation_numbers {
 	SEMIHOSTING_USER_CMD_0X1FF = 0x1FF, /* Last user cmd op code */
 };
 
+/** Size of the buffer that collects SYS_WRITEC and SYS_WRITE0 output */
+#define SEMIHOSTING_CONSOLE_BUFFER_SIZE 256
+
 /** Maximum allowed Tcl command segment length in bytes*/
 #define SEMIHOSTING_MAX_TCL_COMMAND_FIELD_LENGTH (1024 * 1024)
 
@@ -177,6 +180,16 @@ struct semihosting {
 	/** Base directory for semihosting I/O operations. */
 	char *basedir;
 
+	/**
+	 * Console output of SYS_WRITEC and SYS_WRITE0 that was not written to
+	 * the host yet. It is flushed at the end of a line, when it is full,
+	 * on any other semihosting call and by a timer shortly after the last
+	 * write.
+	 */
+	uint8_t console_buffer[SEMIHOSTING_CONSOLE_BUFFER_SIZE];
+	unsigned int console_length;
+	bool console_timer_pending;
+
 	/**
 	 * Target's extension of semihosting user commands.
 	 * @returns ERROR_NOT_IMPLEMENTED when user command is not handled, otherwise
@@ -191,6 +204,7 @@ struct semihosting {
 int semihosting_common_init(struct target *target, void *setup,
 	void *post_result);
 int semihosting_common(struct target *target);
+void semihosting_common_exit(struct target *target);
 
 /* utility functions which may also be used by semihosting extensions (custom vendor-defined syscalls) */
 int semihosting_read_fields(struct target *target, size_t number,
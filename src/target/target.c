@@ -44,6 +44,7 @@
 #include "register.h"
 #include "trace.h"
 #include "image.h"
+#include "profile.h"
 #include "rtos/rtos.h"
 #include "transport/transport.h"
 #include "arm_cti.h"
@@ -65,6 +66,13 @@ static int target_read_buffer_default(struct target *target, target_addr_t addre
 static int target_write_buffer_default(struct target *target, target_addr_t address,
 		uint32_t count, const uint8_t *buffer);
 static int target_register_user_commands(struct command_context *cmd_ctx);
+static int target_backup_working_areas(struct target *target,
+		target_addr_t address, target_addr_t size);
+static bool target_release_pinned_working_areas(struct target *target);
+static void target_forget_pinned_working_areas(struct target *target);
+static void target_release_overwritten_pinned_areas(struct target *target,
+		target_addr_t address, target_addr_t size);
+static void target_schedule_early_poll(void);
 static int target_get_gdb_fileio_info_default(struct target *target,
 		struct gdb_fileio_info *fileio_info);
 static int target_gdb_fileio_end_default(struct target *target, int retcode,
@@ -493,10 +501,16 @@ int target_poll(struct target *target)
 		return ERROR_FAIL;
 	}
 
+	enum target_state prev_state = target->state;
 	retval = target->type->poll(target);
 	if (retval != ERROR_OK)
 		return retval;
 
+	/* Started running without target_resume(), e.g. resumed by another
+	 * debugger or along with the rest of an SMP group */
+	if (prev_state != TARGET_RUNNING && target->state == TARGET_RUNNING)
+		target_forget_pinned_working_areas(target);
+
 	if (target->halt_issued) {
 		if (target->state == TARGET_HALTED)
 			target->halt_issued = false;
@@ -575,6 +589,14 @@ int target_resume(struct target *target, bool current, target_addr_t address,
 
 	target_call_event_callbacks(target, TARGET_EVENT_RESUME_START);
 
+	/* The program may overwrite the algorithms kept in the working area */
+	if (!debug_execution)
+		target_release_pinned_working_areas(target);
+
+	retval = target_backup_working_areas(target, 0, TARGET_ADDR_MAX);
+	if (retval != ERROR_OK)
+		return retval;
+
 	/* note that resume *must* be asynchronous. The CPU can halt before
 	 * we poll. The CPU can even halt at the current PC as a result of
 	 * a software breakpoint being inserted by (a bug?) the application.
@@ -597,6 +619,9 @@ int target_resume(struct target *target, bool current, target_addr_t address,
 
 	target_call_event_callbacks(target, TARGET_EVENT_RESUME_END);
 
+	if (!debug_execution)
+		target_schedule_early_poll();
+
 	return retval;
 }
 
@@ -612,8 +637,10 @@ static int target_process_reset(struct command_invocation *cmd, enum target_rese
 	}
 
 	struct target *target;
-	for (target = all_targets; target; target = target->next)
+	for (target = all_targets; target; target = target->next) {
+		target_forget_pinned_working_areas(target);
 		target_call_reset_callbacks(target, reset_mode);
+	}
 
 	/* disable polling during reset to make reset event scripts
 	 * more predictable, i.e. dr/irscan & pathmove in events will
@@ -798,6 +825,10 @@ int target_run_algorithm(struct target *target,
 		goto done;
 	}
 
+	retval = target_backup_working_areas(target, 0, TARGET_ADDR_MAX);
+	if (retval != ERROR_OK)
+		goto done;
+
 	target->running_alg = true;
 	retval = target->type->run_algorithm(target,
 			num_mem_params, mem_params,
@@ -843,6 +874,10 @@ int target_start_algorithm(struct target *target,
 		goto done;
 	}
 
+	retval = target_backup_working_areas(target, 0, TARGET_ADDR_MAX);
+	if (retval != ERROR_OK)
+		goto done;
+
 	target->running_alg = true;
 	retval = target->type->start_algorithm(target,
 			num_mem_params, mem_params,
@@ -1283,6 +1318,10 @@ int target_write_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support write_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	target_release_overwritten_pinned_areas(target, address, (target_addr_t)size * count);
+	int retval = target_backup_working_areas(target, address, (target_addr_t)size * count);
+	if (retval != ERROR_OK)
+		return retval;
 	return target->type->write_memory(target, address, size, count, buffer);
 }
 
@@ -1297,6 +1336,10 @@ int target_write_phys_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support write_phys_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	target_release_overwritten_pinned_areas(target, address, (target_addr_t)size * count);
+	int retval = target_backup_working_areas(target, address, (target_addr_t)size * count);
+	if (retval != ERROR_OK)
+		return retval;
 	return target->type->write_phys_memory(target, address, size, count, buffer);
 }
 
@@ -1408,6 +1451,22 @@ int target_get_gdb_reg_list_noread(struct target *target,
 	return target_get_gdb_reg_list(target, reg_list, reg_list_size, reg_class);
 }
 
+int target_read_registers(struct target *target, struct reg **reg_list,
+		int reg_list_size)
+{
+	if (!target->type->read_registers)
+		return ERROR_OK;
+	return target->type->read_registers(target, reg_list, reg_list_size);
+}
+
+int target_write_registers(struct target *target, struct reg **reg_list,
+		int reg_list_size)
+{
+	if (!target->type->write_registers)
+		return ERROR_OK;
+	return target->type->write_registers(target, reg_list, reg_list_size);
+}
+
 bool target_supports_gdb_connection(const struct target *target)
 {
 	/*
@@ -1422,6 +1481,12 @@ int target_step(struct target *target,
 {
 	int retval;
 
+	target_release_pinned_working_areas(target);
+
+	retval = target_backup_working_areas(target, 0, TARGET_ADDR_MAX);
+	if (retval != ERROR_OK)
+		return retval;
+
 	target_call_event_callbacks(target, TARGET_EVENT_STEP_START);
 
 	retval = target->type->step(target, current, address, handle_breakpoints);
@@ -1481,8 +1546,36 @@ static int target_profiling(struct target *target, uint32_t *samples,
 			num_samples, seconds);
 }
 
+int target_sample_pc(struct target *target, uint32_t *samples,
+		uint32_t max_num_samples, uint32_t *num_samples)
+{
+	*num_samples = 0;
+	if (!target->type->sample_pc)
+		return ERROR_NOT_IMPLEMENTED;
+	return target->type->sample_pc(target, samples, max_num_samples,
+			num_samples);
+}
+
 static int handle_target(void *priv);
 
+/* A target often halts again soon after it was resumed, e.g. when gdb steps
+ * over a function call. Rather than leaving that halt to the next periodic
+ * poll, the targets are polled 1ms after a resume and then again after twice
+ * the previous delay, until the delay reaches polling_interval or no target
+ * is running anymore. */
+#define EARLY_POLL_FIRST_DELAY_MS	1
+
+/* Delay of the pending early poll, 0 if there is none */
+static int early_poll_delay;
+/* Bumped whenever the early polls start over, so that a poll that resumed
+ * a target does not schedule a second chain of early polls */
+static unsigned int early_poll_generation;
+static Jim_Interp *early_poll_interp;
+
+/* Set when a target resumes, to tell the polls that resumed a target from
+ * the ordinary ones in target_update_slow_poll() */
+static bool target_resumed;
+
 static int target_init_one(struct command_context *cmd_ctx,
 		struct target *target)
 {
@@ -1565,6 +1658,7 @@ static int target_init(struct command_context *cmd_ctx)
 			polling_interval, TARGET_TIMER_TYPE_PERIODIC, cmd_ctx->interp);
 	if (retval != ERROR_OK)
 		return retval;
+	early_poll_interp = cmd_ctx->interp;
 
 	return ERROR_OK;
 }
@@ -1762,7 +1856,7 @@ int target_unregister_timer_callback(int (*callback)(void *priv), void *priv)
 
 	for (struct target_timer_callback *c = target_timer_callbacks;
 	     c; c = c->next) {
-		if ((c->callback == callback) && (c->priv == priv)) {
+		if (c->callback == callback && c->priv == priv && !c->removed) {
 			c->removed = true;
 			return ERROR_OK;
 		}
@@ -1781,6 +1875,17 @@ int target_call_event_callbacks(struct target *target, enum target_event event)
 		target_call_event_callbacks(target, TARGET_EVENT_GDB_HALT);
 	}
 
+	if (event == TARGET_EVENT_RESUMED) {
+		/* The target may have been resumed without target_resume(), e.g.
+		 * by a semihosting call handled while polling */
+		target_forget_pinned_working_areas(target);
+
+		/* A slow poll before the resume says nothing about the next ones */
+		target->slow_poll.times = 0;
+		target->slow_poll.count = 0;
+		target_resumed = true;
+	}
+
 	LOG_DEBUG("target event %i (%s) for core %s", event,
 			target_event_name(event),
 			target_name(target));
@@ -1931,6 +2036,8 @@ static void target_split_working_area(struct working_area *area, uint32_t size)
 		new_wa->size = area->size - size;
 		new_wa->address = area->address + size;
 		new_wa->backup = NULL;
+		new_wa->backup_valid = false;
+		new_wa->pinned_name = NULL;
 		new_wa->user = NULL;
 		new_wa->free = true;
 
@@ -1973,6 +2080,149 @@ static void target_merge_working_areas(struct target *target)
 	}
 }
 
+static int target_restore_working_area(struct target *target, struct working_area *area)
+{
+	int retval = ERROR_OK;
+
+	if (target->backup_working_area && area->backup_valid) {
+		retval = target_write_memory(target, area->address, 4, area->size / 4, area->backup);
+		if (retval != ERROR_OK)
+			LOG_ERROR("failed to restore %" PRIu32 " bytes of working area at address " TARGET_ADDR_FMT,
+					area->size, area->address);
+	}
+
+	return retval;
+}
+
+/* Find the smallest free working area of at least size bytes */
+static struct working_area *target_find_working_area(struct target *target, uint32_t size)
+{
+	struct working_area *best = NULL;
+
+	for (struct working_area *c = target->working_areas; c; c = c->next) {
+		if (c->free && c->size >= size && (!best || c->size < best->size))
+			best = c;
+	}
+
+	return best;
+}
+
+/* Free an area that keeps an algorithm; the caller merges the free areas */
+static void target_release_pinned_working_area(struct target *target, struct working_area *area)
+{
+	char *name = area->pinned_name;
+
+	LOG_DEBUG("dropping algorithm %s at address " TARGET_ADDR_FMT,
+			name, area->address);
+	/* No longer pinned while the backup is written back, so that write
+	 * does not try to release it again */
+	area->pinned_name = NULL;
+	target_restore_working_area(target, area);
+	free(name);
+	area->free = true;
+	area->backup_valid = false;
+}
+
+/* Free the areas that keep an algorithm nobody uses right now.
+ * Returns true if any was freed. */
+static bool target_release_pinned_working_areas(struct target *target)
+{
+	bool released = false;
+
+	for (struct working_area *c = target->working_areas; c; c = c->next) {
+		if (c->free || !c->pinned_name || c->user)
+			continue;
+
+		target_release_pinned_working_area(target, c);
+		released = true;
+	}
+
+	if (released)
+		target_merge_working_areas(target);
+
+	return released;
+}
+
+/* Free the areas that keep an algorithm nobody uses right now, without
+ * writing their backup back: the target runs or is being reset, so the
+ * algorithms may already be overwritten and the memory must not be touched */
+static void target_forget_pinned_working_areas(struct target *target)
+{
+	bool forgotten = false;
+
+	for (struct working_area *c = target->working_areas; c; c = c->next) {
+		if (c->free || !c->pinned_name || c->user)
+			continue;
+
+		LOG_DEBUG("forgetting algorithm %s at address " TARGET_ADDR_FMT,
+				c->pinned_name, c->address);
+		free(c->pinned_name);
+		c->pinned_name = NULL;
+		c->free = true;
+		c->backup_valid = false;
+		forgotten = true;
+	}
+
+	if (forgotten)
+		target_merge_working_areas(target);
+}
+
+/* Free the areas that keep an algorithm nobody uses right now and that
+ * overlap [address, address + size), which is about to be written. The
+ * algorithm would not match its checksum anymore. */
+static void target_release_overwritten_pinned_areas(struct target *target,
+		target_addr_t address, target_addr_t size)
+{
+	bool released = false;
+
+	if (!size)
+		return;
+
+	for (struct working_area *c = target->working_areas; c; c = c->next) {
+		if (c->free || !c->pinned_name || c->user)
+			continue;
+		if (c->address > address + (size - 1) || address > c->address + (c->size - 1))
+			continue;
+
+		target_release_pinned_working_area(target, c);
+		released = true;
+	}
+
+	if (released)
+		target_merge_working_areas(target);
+}
+
+/* Save the content of the allocated working areas overlapping
+ * [address, address + size) before they are modified for the first time.
+ * Running code may modify any of them, so it backs up the whole address
+ * range. */
+static int target_backup_working_areas(struct target *target,
+		target_addr_t address, target_addr_t size)
+{
+	if (!target->backup_working_area || !size)
+		return ERROR_OK;
+
+	for (struct working_area *c = target->working_areas; c; c = c->next) {
+		if (c->free || c->backup_valid)
+			continue;
+		if (c->address > address + (size - 1) || address > c->address + (c->size - 1))
+			continue;
+
+		if (!c->backup) {
+			c->backup = malloc(c->size);
+			if (!c->backup)
+				return ERROR_FAIL;
+		}
+
+		int retval = target_read_memory(target, c->address, 4, c->size / 4, c->backup);
+		if (retval != ERROR_OK)
+			return retval;
+		c->backup_valid = true;
+	}
+
+	return ERROR_OK;
+}
+
 int target_alloc_working_area_try(struct target *target, uint32_t size, struct working_area **area)
 {
 	/* Reevaluate working area address based on MMU state*/
@@ -2015,6 +2265,8 @@ int target_alloc_working_area_try(struct target *target, uint32_t size, struct w
 			new_wa->size = ALIGN_DOWN(target->working_area_size, 4); /* 4-byte align */
 			new_wa->address = target->working_area;
 			new_wa->backup = NULL;
+			new_wa->backup_valid = false;
+			new_wa->pinned_name = NULL;
 			new_wa->user = NULL;
 			new_wa->free = true;
 		}
@@ -2025,14 +2277,11 @@ int target_alloc_working_area_try(struct target *target, uint32_t size, struct w
 	/* only allocate multiples of 4 byte */
 	size = ALIGN_UP(size, 4);
 
-	struct working_area *c = target->working_areas;
+	struct working_area *c = target_find_working_area(target, size);
 
-	/* Find the first large enough working area */
-	while (c) {
-		if (c->free && c->size >= size)
-			break;
-		c = c->next;
-	}
+	/* Make room by dropping the algorithms nobody uses right now */
+	if (!c && target_release_pinned_working_areas(target))
+		c = target_find_working_area(target, size);
 
 	if (!c)
 		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
@@ -2043,17 +2292,9 @@ int target_alloc_working_area_try(struct target *target, uint32_t size, struct w
 	LOG_DEBUG("allocated new working area of %" PRIu32 " bytes at address " TARGET_ADDR_FMT,
 			  size, c->address);
 
-	if (target->backup_working_area) {
-		if (!c->backup) {
-			c->backup = malloc(c->size);
-			if (!c->backup)
-				return ERROR_FAIL;
-		}
-
-		int retval = target_read_memory(target, c->address, 4, c->size / 4, c->backup);
-		if (retval != ERROR_OK)
-			return retval;
-	}
+	/* The backup is only read when the area is about to be modified, see
+	 * target_backup_working_areas() */
+	c->backup_valid = false;
 
 	/* mark as used, and return the new (reused) area */
 	c->free = false;
@@ -2078,18 +2319,56 @@ int target_alloc_working_area(struct target *target, uint32_t size, struct worki
 
 }
 
-static int target_restore_working_area(struct target *target, struct working_area *area)
+int target_alloc_algorithm_working_area(struct target *target, const char *name,
+		const uint8_t *code, uint32_t size, struct working_area **area)
 {
-	int retval = ERROR_OK;
+	uint32_t crc;
+	int retval = image_calculate_checksum(code, size, &crc);
+	if (retval != ERROR_OK)
+		return retval;
 
-	if (target->backup_working_area && area->backup) {
-		retval = target_write_memory(target, area->address, 4, area->size / 4, area->backup);
-		if (retval != ERROR_OK)
-			LOG_ERROR("failed to restore %" PRIu32 " bytes of working area at address " TARGET_ADDR_FMT,
-					area->size, area->address);
+	bool in_use = false;
+	for (struct working_area *c = target->working_areas; c; c = c->next) {
+		if (c->free || !c->pinned_name || strcmp(c->pinned_name, name) != 0)
+			continue;
+
+		/* Already in use, e.g. by a nested call; give this one its own copy */
+		if (c->user) {
+			in_use = true;
+			break;
+		}
+
+		if (c->pinned_size == size && c->pinned_crc == crc) {
+			LOG_DEBUG("reusing algorithm %s at address " TARGET_ADDR_FMT,
+					name, c->address);
+			c->user = area;
+			*area = c;
+			return ERROR_OK;
+		}
+
+		/* Some other version of the algorithm */
+		target_release_pinned_working_area(target, c);
+		target_merge_working_areas(target);
+		break;
 	}
 
-	return retval;
+	retval = target_alloc_working_area(target, size, area);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = target_write_buffer(target, (*area)->address, size, code);
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, *area);
+		return retval;
+	}
+
+	if (!in_use) {
+		(*area)->pinned_name = strdup(name);
+		(*area)->pinned_size = size;
+		(*area)->pinned_crc = crc;
+	}
+
+	return ERROR_OK;
 }
 
 /* Restore the area's backup memory, if any, and return the area to the allocation pool */
@@ -2098,6 +2377,14 @@ static int target_free_working_area_restore(struct target *target, struct workin
 	if (!area || area->free)
 		return ERROR_OK;
 
+	if (area->pinned_name) {
+		/* Keep the algorithm for its next user */
+		if (area->user)
+			*area->user = NULL;
+		area->user = NULL;
+		return ERROR_OK;
+	}
+
 	int retval = ERROR_OK;
 	if (restore) {
 		retval = target_restore_working_area(target, area);
@@ -2107,6 +2394,7 @@ static int target_free_working_area_restore(struct target *target, struct workin
 	}
 
 	area->free = true;
+	area->backup_valid = false;
 
 	LOG_DEBUG("freed %" PRIu32 " bytes of working area at address " TARGET_ADDR_FMT,
 			area->size, area->address);
@@ -2115,7 +2403,8 @@ static int target_free_working_area_restore(struct target *target, struct workin
 	/* TODO: Is this really safe? It points to some previous caller's memory.
 	 * How could we know that the area pointer is still in that place and not
 	 * some other vital data? What's the purpose of this, anyway? */
-	*area->user = NULL;
+	if (area->user)
+		*area->user = NULL;
 	area->user = NULL;
 
 	target_merge_working_areas(target);
@@ -2145,7 +2434,11 @@ static void target_free_all_working_areas_restore(struct target *target, int res
 			if (restore)
 				target_restore_working_area(target, c);
 			c->free = true;
-			*c->user = NULL; /* Same as above */
+			c->backup_valid = false;
+			free(c->pinned_name);
+			c->pinned_name = NULL;
+			if (c->user)
+				*c->user = NULL; /* Same as above */
 			c->user = NULL;
 		}
 		c = c->next;
@@ -2170,18 +2463,25 @@ void target_free_all_working_areas(struct target *target)
 	}
 }
 
-/* Find the largest number of bytes that can be allocated */
+/* Find the largest number of bytes that can be allocated, counting the
+ * algorithms that would be dropped to make room */
 uint32_t target_get_working_area_avail(struct target *target)
 {
 	struct working_area *c = target->working_areas;
 	uint32_t max_size = 0;
+	uint32_t size = 0;
 
 	if (!c)
 		return ALIGN_DOWN(target->working_area_size, 4);
 
 	while (c) {
-		if (c->free && max_size < c->size)
-			max_size = c->size;
+		if (c->free || (c->pinned_name && !c->user))
+			size += c->size;
+		else
+			size = 0;
+
+		if (max_size < size)
+			max_size = size;
 
 		c = c->next;
 	}
@@ -2193,13 +2493,16 @@ static void target_destroy(struct target *target)
 {
 	breakpoint_remove_all(target);
 	watchpoint_remove_all(target);
+	breakpoint_free_index(target);
+
+	/* the register caches themselves are freed by the target type */
+	for (struct reg_cache *cache = target->reg_cache; cache; cache = cache->next)
+		register_cache_free_index(cache);
 
 	if (target->type->deinit_target)
 		target->type->deinit_target(target);
 
-	if (target->semihosting)
-		free(target->semihosting->basedir);
-	free(target->semihosting);
+	semihosting_common_exit(target);
 
 	jtag_unregister_event_callback(jtag_enable_callback, target);
 
@@ -2369,6 +2672,11 @@ int target_write_buffer(struct target *target, target_addr_t address, uint32_t s
 		return ERROR_FAIL;
 	}
 
+	target_release_overwritten_pinned_areas(target, address, size);
+	int retval = target_backup_working_areas(target, address, size);
+	if (retval != ERROR_OK)
+		return retval;
+
 	return target->type->write_buffer(target, address, size, buffer);
 }
 
@@ -2913,6 +3221,84 @@ static int sense_handler(void)
 	return ERROR_OK;
 }
 
+/* Polls of a target that take longer than the polling interval delay the
+ * polls of all the other targets. Such a target is skipped for as many
+ * intervals as its poll took, up to 5000ms, while there are other targets
+ * to poll. Polls that change the state of the target, e.g. handling a halt
+ * or a semihosting call, are slow for a reason and are not counted. */
+static void target_update_slow_poll(struct target *target,
+		enum target_state prev_state, int64_t poll_time)
+{
+	int times = 0;
+
+	if (target->state != prev_state || target_resumed)
+		return;
+
+	if (all_targets->next && poll_time > polling_interval)
+		times = MIN(poll_time, 5000) / polling_interval;
+
+	if (times != target->slow_poll.times) {
+		if (times)
+			LOG_TARGET_DEBUG(target, "Polling took %" PRId64 "ms, polling every %dms",
+					poll_time, (times + 1) * polling_interval);
+		target->slow_poll.times = times;
+	}
+}
+
+static int handle_early_poll(void *priv)
+{
+	unsigned int generation = early_poll_generation;
+	bool running = false;
+
+	/* Only a quick check of the running targets. Anything else, such as
+	 * re-examining a failing target, polling a slow one or the srst and
+	 * power procs, is left to handle_target() and its own pace. */
+	for (struct target *target = all_targets;
+			is_jtag_poll_safe() && target;
+			target = target->next) {
+		if (!target_was_examined(target) || !target->tap->enabled ||
+				target->state != TARGET_RUNNING)
+			continue;
+		if (target->backoff.times || target->slow_poll.times)
+			continue;
+		if (power_dropout || srst_asserted)
+			continue;
+
+		/* A failure is noticed and handled by the next regular poll */
+		target_poll(target);
+		running |= target->state == TARGET_RUNNING;
+	}
+
+	/* A target resumed by the polls above already started a new chain */
+	if (generation != early_poll_generation)
+		return ERROR_OK;
+
+	early_poll_delay *= 2;
+	if (!running || early_poll_delay >= polling_interval) {
+		early_poll_delay = 0;
+		return ERROR_OK;
+	}
+
+	return target_register_timer_callback(&handle_early_poll, early_poll_delay,
+			TARGET_TIMER_TYPE_ONESHOT, priv);
+}
+
+static void target_schedule_early_poll(void)
+{
+	if (!early_poll_interp)
+		return;
+
+	/* Start over, the target just resumed may halt right away */
+	if (early_poll_delay)
+		target_unregister_timer_callback(&handle_early_poll, early_poll_interp);
+
+	early_poll_generation++;
+	early_poll_delay = EARLY_POLL_FIRST_DELAY_MS;
+	if (target_register_timer_callback(&handle_early_poll, early_poll_delay,
+			TARGET_TIMER_TYPE_ONESHOT, early_poll_interp) != ERROR_OK)
+		early_poll_delay = 0;
+}
+
 /* process target state changes */
 static int handle_target(void *priv)
 {
@@ -2970,7 +3356,10 @@ static int handle_target(void *priv)
 
 	/* Poll targets for state changes unless that's globally disabled.
 	 * Skip targets that are currently disabled.
+	 * A failing or slow target must not hold up the others: its failure
+	 * does not end the loop, and it is polled less often.
 	 */
+	int result = ERROR_OK;
 	for (struct target *target = all_targets;
 			is_jtag_poll_safe() && target;
 			target = target->next) {
@@ -2988,10 +3377,20 @@ static int handle_target(void *priv)
 		}
 		target->backoff.count = 0;
 
+		if (target->slow_poll.times > target->slow_poll.count) {
+			target->slow_poll.count++;
+			continue;
+		}
+		target->slow_poll.count = 0;
+
 		/* only poll target if we've got power and srst isn't asserted */
 		if (!power_dropout && !srst_asserted) {
 			/* polling may fail silently until the target has been examined */
+			enum target_state prev_state = target->state;
+			int64_t poll_start = timeval_ms();
+			target_resumed = false;
 			retval = target_poll(target);
+			target_update_slow_poll(target, prev_state, timeval_ms() - poll_start);
 			if (retval != ERROR_OK) {
 				/* 100ms polling interval. Increase interval between polling up to 5000ms */
 				if (target->backoff.times * polling_interval < 5000) {
@@ -3014,7 +3413,8 @@ static int handle_target(void *priv)
 					target_set_examined(target);
 					LOG_TARGET_ERROR(target, "Examination failed, GDB will be halted. Polling again in %dms",
 						 target->backoff.times * polling_interval);
-					return retval;
+					result = retval;
+					continue;
 				}
 			}
 
@@ -3023,7 +3423,7 @@ static int handle_target(void *priv)
 		}
 	}
 
-	return retval;
+	return result;
 }
 
 COMMAND_HANDLER(handle_reg_command)
@@ -5798,6 +6198,7 @@ COMMAND_HANDLER(handle_target_create)
 	target->reg_cache           = NULL;
 	target->breakpoints         = NULL;
 	target->watchpoints         = NULL;
+	target->bpwp_index          = NULL;
 	target->next                = NULL;
 	target->arch_info           = NULL;
 
@@ -6524,6 +6925,13 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.usage = "seconds filename [start end]",
 		.help = "profiling samples the CPU PC",
 	},
+	{
+		.name = "profile_live",
+		.mode = COMMAND_EXEC,
+		.help = "continuous profiling with a bounded PC histogram",
+		.usage = "",
+		.chain = profile_live_command_handlers,
+	},
 	/** @todo don't register virt2phys() unless target supports it */
 	{
 		.name = "virt2phys",
@@ -32,6 +32,7 @@ struct command_context;
 struct command_invocation;
 struct breakpoint;
 struct watchpoint;
+struct bpwp_index;
 struct mem_param;
 struct reg_param;
 struct target_list;
@@ -90,6 +91,12 @@ struct working_area {
 	uint32_t size;
 	bool free;
 	uint8_t *backup;
+	/* backup holds the content from before the area was modified */
+	bool backup_valid;
+	/* algorithm kept in the area, see target_alloc_algorithm_working_area() */
+	char *pinned_name;
+	uint32_t pinned_size;
+	uint32_t pinned_crc;
 	struct working_area **user;
 	struct working_area *next;
 };
@@ -161,6 +168,7 @@ struct target {
 	struct reg_cache *reg_cache;		/* the first register cache of the target (core regs) */
 	struct breakpoint *breakpoints;		/* list of breakpoints */
 	struct watchpoint *watchpoints;		/* list of watchpoints */
+	struct bpwp_index *bpwp_index;		/* address index of both lists, see breakpoints.c */
 	struct trace *trace_info;			/* generic trace information */
 	struct debug_msg_receiver *dbgmsg;	/* list of debug message receivers */
 	bool dbg_msg_enabled;				/* debug message status */
@@ -187,6 +195,8 @@ struct target {
 	bool rtos_auto_detect;				/* A flag that indicates that the RTOS has been specified as "auto"
 										 * and must be detected when symbols are offered */
 	struct backoff_timer backoff;
+	struct backoff_timer slow_poll;		/* polls skipped because polling this target
+										 * is slow and holds up the other targets */
 	unsigned int smp;					/* Unique non-zero number for each SMP group */
 	struct list_head *smp_targets;		/* list all targets in this smp group/cluster
 										 * The head of the list is shared between the
@@ -519,6 +529,24 @@ int target_get_gdb_reg_list_noread(struct target *target,
 		struct reg **reg_list[], int *reg_list_size,
 		enum target_register_class reg_class);
 
+/**
+ * Read the invalid registers of @a reg_list in one batch, if the target
+ * supports it.
+ *
+ * This routine is a wrapper for target->type->read_registers.
+ */
+int target_read_registers(struct target *target, struct reg **reg_list,
+		int reg_list_size);
+
+/**
+ * Write the dirty registers of @a reg_list in one batch, if the target
+ * supports it.
+ *
+ * This routine is a wrapper for target->type->write_registers.
+ */
+int target_write_registers(struct target *target, struct reg **reg_list,
+		int reg_list_size);
+
 /**
  * Check if @a target allows GDB connections.
  *
@@ -720,6 +748,15 @@ int target_alloc_working_area(struct target *target,
  */
 int target_alloc_working_area_try(struct target *target,
 		uint32_t size, struct working_area **area);
+/**
+ * Allocates a working area and uploads the algorithm @a code to it.
+ * The area is kept when it is freed, so that the next call with the same
+ * @a name and code returns it again without uploading the code. Kept areas
+ * are released by target_free_all_working_areas(), on resume or reset, or
+ * when an allocation does not fit otherwise.
+ */
+int target_alloc_algorithm_working_area(struct target *target, const char *name,
+		const uint8_t *code, uint32_t size, struct working_area **area);
 /**
  * Free a working area.
  * Restore target data if area backup is configured.
@@ -780,6 +817,13 @@ void target_handle_md_output(struct command_invocation *cmd,
 int target_profiling_default(struct target *target, uint32_t *samples, uint32_t
 		max_num_samples, uint32_t *num_samples, uint32_t seconds);
 
+/**
+ * Read up to @a max_num_samples PC samples of @a target without halting it.
+ * @returns ERROR_NOT_IMPLEMENTED if the target cannot do that.
+ */
+int target_sample_pc(struct target *target, uint32_t *samples,
+		uint32_t max_num_samples, uint32_t *num_samples);
+
 #define ERROR_TARGET_INVALID	(-300)
 #define ERROR_TARGET_INIT_FAILED (-301)
 #define ERROR_TARGET_TIMEOUT	(-302)
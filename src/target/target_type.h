@@ -106,6 +106,25 @@ struct target_type {
 			struct reg **reg_list[], int *reg_list_size,
 			enum target_register_class reg_class);
 
+	/**
+	 * Optional. Read the registers of @a reg_list that are not valid yet
+	 * into the register cache in as few transactions as possible, e.g. for
+	 * the GDB 'g' packet. Registers left invalid are read one by one by the
+	 * caller. Do @b not call this function directly, use
+	 * target_read_registers() instead.
+	 */
+	int (*read_registers)(struct target *target, struct reg **reg_list,
+			int reg_list_size);
+
+	/**
+	 * Optional. Write the dirty registers of @a reg_list to the target in as
+	 * few transactions as possible, e.g. after the GDB 'G' packet. Other
+	 * dirty registers may be written back as well. Do @b not call this
+	 * function directly, use target_write_registers() instead.
+	 */
+	int (*write_registers)(struct target *target, struct reg **reg_list,
+			int reg_list_size);
+
 	/* target memory access
 	* size: 1 = byte (8bit), 2 = half-word (16bit), 4 = word (32bit)
 	* count: number of items of <size>
@@ -296,6 +315,13 @@ struct target_type {
 	int (*profiling)(struct target *target, uint32_t *samples,
 			uint32_t max_num_samples, uint32_t *num_samples, uint32_t seconds);
 
+	/* Read a batch of PC samples of a running target without halting it and
+	 * without logging. Returns ERROR_NOT_IMPLEMENTED if the target has no
+	 * non-intrusive way to sample its PC. Optional.
+	 */
+	int (*sample_pc)(struct target *target, uint32_t *samples,
+			uint32_t max_num_samples, uint32_t *num_samples);
+
 	/* Return the number of address bits this target supports. This will
 	 * typically be 32 for 32-bit targets, and 64 for 64-bit targets. If not
 	 * implemented, it's assumed to be 32. */
@@ -1285,6 +1285,7 @@ void x86_32_common_reset_breakpoints_watchpoints(struct target *t)
 		free(t->watchpoints);
 		t->watchpoints = next_w;
 	}
+	breakpoint_free_index(t);
 
 	for (int i = 0; i < x86_32->num_hw_bpoints; i++) {
 		debug_reg_list[i].used = 0;
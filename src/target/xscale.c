@@ -2863,7 +2863,7 @@ static void xscale_build_reg_cache(struct target *target)
 
 	(*cache_p) = arm_build_reg_cache(target, arm);
 
-	(*cache_p)->next = malloc(sizeof(struct reg_cache));
+	(*cache_p)->next = calloc(1, sizeof(struct reg_cache));
 	cache_p = &(*cache_p)->next;
 
 	/* fill in values for the xscale reg cache */
@@ -2898,6 +2898,7 @@ static void xscale_free_reg_cache(struct target *target)
 
 	free(cache->reg_list[0].arch_info);
 	free(cache->reg_list);
+	register_cache_free_index(cache);
 	free(cache);
 
 	arm_free_reg_cache(&xscale->arm);
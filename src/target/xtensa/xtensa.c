@@ -3474,6 +3474,7 @@ static void xtensa_free_reg_cache(struct target *target)
 		}
 		free(xtensa->algo_context_backup);
 		free(cache->reg_list);
+		register_cache_free_index(cache);
 		free(cache);
 	}
 	xtensa->core_cache = NULL;